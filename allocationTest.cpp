@@ -0,0 +1,93 @@
+/*!
+ * @file
+ * @brief This file contains test that drawing does not allocate memory
+ *
+ * Per-thread storage of the fragment stage, vertex pool, bins and batches are reused
+ * between draw calls, so after a few warm up frames drawTriangles must not call operator new.
+ * The test replaces global operator new/delete by counting versions, draws PhongMethod
+ * from several views around the bunny to warm up, then draws the same views again
+ * and fails if anything was allocated.
+ * It is a standalone executable, build it like the benchmark, e.g.
+ *   add_executable(gpuAllocationTest student/allocationTest.cpp student/gpu.cpp student/phongMethod.cpp student/meshOptimizer.cpp student/bunny.cpp)
+ *
+ * Usage: gpuAllocationTest [--threads N]
+ */
+
+#include <student/gpu.hpp>
+#include <student/phongMethod.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace{
+
+/// number of calls of operator new, counted only while counting is set
+std::atomic<uint64_t> pocetAlokacii(0);
+std::atomic<bool    > pocitat      (false);
+
+void*allocate(std::size_t size){
+  if(pocitat.load(std::memory_order_relaxed))pocetAlokacii.fetch_add(1,std::memory_order_relaxed);
+  void*p = std::malloc(size?size:1);
+  if(!p)throw std::bad_alloc();
+  return p;
+}
+
+}
+
+void*operator new  (std::size_t size){return allocate(size);}
+void*operator new[](std::size_t size){return allocate(size);}
+void*operator new  (std::size_t size,std::nothrow_t const&)noexcept{
+  try{return allocate(size);}catch(...){return nullptr;}
+}
+void*operator new[](std::size_t size,std::nothrow_t const&)noexcept{
+  try{return allocate(size);}catch(...){return nullptr;}
+}
+void operator delete  (void*p)noexcept{std::free(p);}
+void operator delete[](void*p)noexcept{std::free(p);}
+void operator delete  (void*p,std::size_t)noexcept{std::free(p);}
+void operator delete[](void*p,std::size_t)noexcept{std::free(p);}
+
+int main(int argc,char*argv[]){
+  uint32_t threads = 0;
+  for(int i=1;i<argc;++i){
+    if(!std::strcmp(argv[i],"--threads") && i+1<argc)threads = (uint32_t)std::atoi(argv[++i]);
+    else{
+      std::fprintf(stderr,"usage: %s [--threads N]\n",argv[0]);
+      return 1;
+    }
+  }
+
+  uint32_t const views  = 8;
+  uint32_t const warmUp = views;
+  uint32_t const frames = 3*views;
+
+  PhongMethod method;
+  method.gpu.setThreadCount(threads);
+  method.gpu.createFramebuffer(640,480);
+  glm::mat4 proj   = glm::perspective(glm::radians(60.f),640.f/480.f,.1f,100.f);
+  glm::vec3 light  = glm::vec3(10.f,10.f,10.f);
+
+  for(uint32_t f=0;f<warmUp+frames;++f){
+    //camera orbits, so the number of triangles and fragments changes between frames,
+    //warm up covers whole orbit, so tile bins already have their largest size
+    float angle = 6.2831853f*(float)(f%views)/(float)views;
+    glm::vec3 camera = glm::vec3(1.7f*std::sin(angle),.3f,1.7f*std::cos(angle));
+    glm::mat4 view   = glm::lookAt(camera,glm::vec3(0.f,.1f,0.f),glm::vec3(0.f,1.f,0.f));
+    if(f == warmUp)pocitat = true;
+    method.onDraw(proj,view,light,camera);
+  }
+  pocitat = false;
+
+  uint64_t pocet = pocetAlokacii;
+  std::printf("%llu allocations in %u draws with %u threads\n",(unsigned long long)pocet,frames,method.gpu.getThreadCount());
+  if(pocet != 0){
+    std::fprintf(stderr,"FAILED: drawing allocates memory\n");
+    return 1;
+  }
+  std::printf("OK\n");
+  return 0;
+}
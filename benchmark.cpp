@@ -0,0 +1,395 @@
+/*!
+ * @file
+ * @brief This file contains benchmark of the software GPU
+ *
+ * The benchmark renders phong method with the bunny and several synthetic
+ * workloads (many tiny triangles, few huge triangles, overdraw and geometry
+ * clipped by the near plane) and reports time per stage, vertices/s and fragments/s.
+ * It is a standalone executable, build it from this file together with the gpu,
+ * phong method and bunny sources, e.g.
+ *   add_executable(gpuBenchmark student/benchmark.cpp student/gpu.cpp student/phongMethod.cpp student/meshFile.cpp student/meshOptimizer.cpp student/bunny.cpp)
+ *
+ * Per stage times are measured only when BOTH gpu.cpp and this file are compiled
+ * with -DGPU_STATISTICS=1. Without it only whole draw times are reported and
+ * "stages_ms" of every JSON result is null ("statistics": false).
+ *
+ * Usage: gpuBenchmark [--iterations N] [--threads N] [--json file] [--mesh file] [--save-bunny file]
+ *
+ * --mesh renders a mesh file (position in head 0, normal in head 1) with the phong program,
+ * --save-bunny writes the compiled-in bunny as a mesh file.
+ */
+
+#include <student/gpu.hpp>
+#include <student/phongMethod.hpp>
+#include <student/meshFile.hpp>
+#include <student/bunny.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+void phong_VS(OutVertex&outVertex,InVertex const&inVertex,Uniforms const&uniforms);
+void phong_FS(OutFragment&outFragment,InFragment const&inFragment,Uniforms const&uniforms);
+void phong_FS_batch(OutFragment*outFragments,InFragment const*inFragments,uint32_t nofFragments,Uniforms const&uniforms);
+
+namespace{
+
+/// number of fragments shaded during the counting pass
+std::atomic<uint64_t> pocetFragmentov(0);
+
+FragmentShader countedFS = nullptr;
+
+/**
+ * @brief Fragment shader that counts fragments and forwards them to countedFS.
+ */
+void counting_FS(OutFragment&outFragment,InFragment const&inFragment,Uniforms const&uniforms){
+  pocetFragmentov.fetch_add(1,std::memory_order_relaxed);
+  countedFS(outFragment,inFragment,uniforms);
+}
+
+/**
+ * @brief Vertex shader of synthetic workloads, position in attribute 0, color in attribute 1.
+ */
+void synthetic_VS(OutVertex&outVertex,InVertex const&inVertex,Uniforms const&uniforms){
+  outVertex.gl_Position = uniforms.uniform[0].m4*glm::vec4(inVertex.attributes[0].v3,1.f);
+  outVertex.attributes[0].v3 = inVertex.attributes[1].v3;
+}
+
+/**
+ * @brief Fragment shader of synthetic workloads.
+ */
+void synthetic_FS(OutFragment&outFragment,InFragment const&inFragment,Uniforms const&){
+  outFragment.gl_FragColor = glm::vec4(inFragment.attributes[0].v3,1.f);
+}
+
+/**
+ * @brief Result of one benchmark case.
+ */
+struct Result{
+  std::string name;
+  uint32_t width;
+  uint32_t height;
+  uint32_t iterations;
+  uint64_t vertices;
+  uint64_t fragments;
+  double   msClear;
+  double   msDraw;
+  GPUStatistics stats;///< statistics of the timed draws, zero without GPU_STATISTICS
+};
+
+/**
+ * @brief Geometry and program of one synthetic workload.
+ */
+struct Scene{
+  std::vector<float>    vertices;///< interleaved position and color
+  std::vector<uint32_t> indices ;
+  glm::mat4             mvp     = glm::mat4(1.f);
+};
+
+void addVertex(Scene&scene,glm::vec3 const&p,glm::vec3 const&c){
+  uint32_t id = (uint32_t)scene.vertices.size()/6;
+  float data[6] = {p.x,p.y,p.z,c.x,c.y,c.z};
+  scene.vertices.insert(scene.vertices.end(),data,data+6);
+  scene.indices.push_back(id);
+}
+
+void addQuad(Scene&scene,glm::vec3 const&a,glm::vec3 const&b,glm::vec3 const&c,glm::vec3 const&d,glm::vec3 const&color){
+  addVertex(scene,a,color);addVertex(scene,b,color);addVertex(scene,c,color);
+  addVertex(scene,a,color);addVertex(scene,c,color);addVertex(scene,d,color);
+}
+
+/**
+ * @brief Grid of quads covering whole screen, every quad has about 2x2 pixels.
+ */
+Scene tinyTriangles(uint32_t width,uint32_t height){
+  Scene scene;
+  uint32_t nx = width/2,ny = height/2;
+  for(uint32_t y=0;y<ny;++y)
+    for(uint32_t x=0;x<nx;++x){
+      float x0 = -1.f+2.f*x/nx,x1 = -1.f+2.f*(x+1)/nx;
+      float y0 = -1.f+2.f*y/ny,y1 = -1.f+2.f*(y+1)/ny;
+      addQuad(scene,glm::vec3(x0,y0,0.f),glm::vec3(x1,y0,0.f),glm::vec3(x1,y1,0.f),glm::vec3(x0,y1,0.f),glm::vec3((float)x/nx,(float)y/ny,.5f));
+    }
+  return scene;
+}
+
+/**
+ * @brief Few triangles, each much larger than the screen.
+ */
+Scene hugeTriangles(uint32_t,uint32_t){
+  Scene scene;
+  for(int i=0;i<8;++i){
+    float z = .9f-.2f*i;
+    addVertex(scene,glm::vec3(-3.f,-3.f,z),glm::vec3(1.f,0.f,0.f));
+    addVertex(scene,glm::vec3( 5.f,-3.f,z),glm::vec3(0.f,1.f,0.f));
+    addVertex(scene,glm::vec3(-3.f, 5.f,z),glm::vec3(0.f,0.f,1.f));
+  }
+  return scene;
+}
+
+/**
+ * @brief Full screen layers, either drawn back to front (every layer passes depth test) or front to back.
+ */
+Scene overdraw(bool backToFront){
+  Scene scene;
+  int const layers = 32;
+  for(int i=0;i<layers;++i){
+    float z = backToFront ? .9f-1.8f*i/layers : -.9f+1.8f*i/layers;
+    addQuad(scene,glm::vec3(-1.f,-1.f,z),glm::vec3(1.f,-1.f,z),glm::vec3(1.f,1.f,z),glm::vec3(-1.f,1.f,z),glm::vec3((float)i/layers,.5f,1.f-(float)i/layers));
+  }
+  return scene;
+}
+
+/**
+ * @brief Ground plane viewed from low height, large part of it is behind the near plane.
+ */
+Scene nearClipped(uint32_t width,uint32_t height){
+  Scene scene;
+  int const n = 64;
+  for(int y=0;y<n;++y)
+    for(int x=0;x<n;++x){
+      float x0 = -20.f+40.f*x/n,x1 = -20.f+40.f*(x+1)/n;
+      float z0 = -20.f+40.f*y/n,z1 = -20.f+40.f*(y+1)/n;
+      addQuad(scene,glm::vec3(x0,0.f,z0),glm::vec3(x1,0.f,z0),glm::vec3(x1,0.f,z1),glm::vec3(x0,0.f,z1),glm::vec3((x+y)%2,.5f,.5f));
+    }
+  glm::mat4 proj = glm::perspective(glm::radians(90.f),(float)width/(float)height,.5f,100.f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.f,.3f,0.f),glm::vec3(0.f,-.2f,-1.f),glm::vec3(0.f,1.f,0.f));
+  scene.mvp = proj*view;
+  return scene;
+}
+
+double elapsed(std::chrono::steady_clock::time_point const&start){
+  return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+}
+
+double median(std::vector<double>v){
+  std::sort(v.begin(),v.end());
+  return v[v.size()/2];
+}
+
+/**
+ * @brief This function measures one draw call.
+ *
+ * The first run counts fragments with counting_FS, then the draw is repeated iterations times
+ * and median times of clear and draw are reported. The timed draws use fsBatch if it is given.
+ */
+template<typename DRAW>
+Result measure(GPU&gpu,ProgramID prg,VertexShader vs,FragmentShader fs,FragmentShaderBatch fsBatch,std::string const&name,uint32_t vertices,uint32_t iterations,DRAW const&draw){
+  Result r;
+  r.name       = name;
+  r.width      = gpu.getFramebufferWidth();
+  r.height     = gpu.getFramebufferHeight();
+  r.iterations = iterations;
+  r.vertices   = vertices;
+
+  countedFS = fs;
+  pocetFragmentov = 0;
+  gpu.attachShaders(prg,vs,counting_FS);
+  gpu.clear(.5f,.5f,.5f,1.f);
+  draw();
+  r.fragments = pocetFragmentov;
+  gpu.attachShaders(prg,vs,fs);
+  if(fsBatch)gpu.attachFragmentShaderBatch(prg,fsBatch);
+
+  draw();//warm up
+  gpu.resetStatistics();
+  std::vector<double>clearTimes,drawTimes;
+  for(uint32_t i=0;i<iterations;++i){
+    auto start = std::chrono::steady_clock::now();
+    gpu.clear(.5f,.5f,.5f,1.f);
+    clearTimes.push_back(elapsed(start));
+    start = std::chrono::steady_clock::now();
+    draw();
+    drawTimes.push_back(elapsed(start));
+  }
+  r.msClear = median(clearTimes);
+  r.msDraw  = median(drawTimes);
+  r.stats   = gpu.getStatistics();
+  return r;
+}
+
+Result runSynthetic(GPU&gpu,std::string const&name,Scene const&scene,uint32_t iterations){
+  BufferID vbo = gpu.createBuffer(scene.vertices.size()*sizeof(float));
+  gpu.setBufferData(vbo,0,scene.vertices.size()*sizeof(float),scene.vertices.data());
+  BufferID ibo = gpu.createBuffer(scene.indices.size()*sizeof(uint32_t));
+  gpu.setBufferData(ibo,0,scene.indices.size()*sizeof(uint32_t),scene.indices.data());
+
+  VertexPullerID vao = gpu.createVertexPuller();
+  gpu.setVertexPullerIndexing(vao,IndexType::UINT32,ibo);
+  gpu.setVertexPullerHead(vao,0,AttributeType::VEC3,6*sizeof(float),0,vbo);
+  gpu.setVertexPullerHead(vao,1,AttributeType::VEC3,6*sizeof(float),3*sizeof(float),vbo);
+  gpu.enableVertexPullerHead(vao,0);
+  gpu.enableVertexPullerHead(vao,1);
+
+  ProgramID prg = gpu.createProgram();
+  gpu.attachShaders(prg,synthetic_VS,synthetic_FS);
+  gpu.setVS2FSType(prg,0,AttributeType::VEC3);
+  gpu.programUniformMatrix4f(prg,0,scene.mvp);
+
+  uint32_t count = (uint32_t)scene.indices.size();
+  Result r = measure(gpu,prg,synthetic_VS,synthetic_FS,nullptr,name,count,iterations,[&]{
+    gpu.bindVertexPuller(vao);
+    gpu.useProgram(prg);
+    gpu.drawTriangles(count);
+    gpu.unbindVertexPuller();
+  });
+
+  gpu.deleteProgram(prg);
+  gpu.deleteVertexPuller(vao);
+  gpu.deleteBuffer(ibo);
+  gpu.deleteBuffer(vbo);
+  return r;
+}
+
+Result runPhong(PhongMethod&method,std::string const&name,VertexPullerID vao,uint32_t count,uint32_t iterations){
+  GPU&gpu = method.gpu;
+  float aspect = (float)gpu.getFramebufferWidth()/(float)gpu.getFramebufferHeight();
+  glm::mat4 proj   = glm::perspective(glm::radians(60.f),aspect,.1f,100.f);
+  glm::vec3 camera = glm::vec3(0.f,.3f,1.7f);
+  glm::mat4 view   = glm::lookAt(camera,glm::vec3(0.f,.1f,0.f),glm::vec3(0.f,1.f,0.f));
+  glm::vec3 light  = glm::vec3(10.f,10.f,10.f);
+  return measure(gpu,method.prg,phong_VS,phong_FS,phong_FS_batch,name,count,iterations,[&]{
+    gpu.bindVertexPuller(vao);
+    gpu.useProgram(method.prg);
+    gpu.uniformBlockMatrix4f(method.ubo,0,view  );
+    gpu.uniformBlockMatrix4f(method.ubo,1,proj  );
+    gpu.uniformBlock3f      (method.ubo,2,light );
+    gpu.uniformBlock3f      (method.ubo,3,camera);
+    gpu.drawTriangles(count);
+    gpu.unbindVertexPuller();
+  });
+}
+
+void printResult(Result const&r){
+  double s = r.msDraw/1000.;
+  std::printf("%-24s %5ux%-5u draw %9.3f ms  clear %7.3f ms  %8.2f Mvert/s  %8.2f Mfrag/s\n",
+      r.name.c_str(),r.width,r.height,r.msDraw,r.msClear,
+      s>0?r.vertices/s/1e6:0.,s>0?r.fragments/s/1e6:0.);
+#if GPU_STATISTICS
+  GPUStatistics const&t = r.stats;
+  double n = r.iterations;
+  std::printf("  per draw: pull %.3f  VS %.3f  clip %.3f  setup %.3f  raster %.3f  FS %.3f  ROP %.3f ms\n",
+      t.msPull/n,t.msVS/n,t.msClip/n,t.msSetup/n,t.msRaster/n,t.msFS/n,t.msROP/n);
+  std::printf("            %llu shaded, %llu/%llu/%llu tris in/clipped/culled, %llu/%llu/%llu frags generated/killed/written\n",
+      (unsigned long long)(t.verticesShaded/r.iterations),(unsigned long long)(t.trianglesIn/r.iterations),
+      (unsigned long long)(t.trianglesClipped/r.iterations),(unsigned long long)(t.trianglesCulled/r.iterations),
+      (unsigned long long)(t.fragmentsGenerated/r.iterations),(unsigned long long)(t.fragmentsDepthKilled/r.iterations),
+      (unsigned long long)(t.fragmentsWritten/r.iterations));
+#endif
+}
+
+void writeJson(std::FILE*f,std::vector<Result>const&results,uint32_t threads){
+  std::fprintf(f,"{\n  \"threads\": %u,\n  \"statistics\": %s,\n  \"results\": [\n",threads,GPU_STATISTICS?"true":"false");
+  for(size_t i=0;i<results.size();++i){
+    Result const&r = results[i];
+    double s = r.msDraw/1000.;
+    std::fprintf(f,"    {\"name\": \"%s\", \"width\": %u, \"height\": %u, \"iterations\": %u, "
+        "\"vertices\": %llu, \"fragments\": %llu, "
+        "\"ms\": {\"clear\": %.4f, \"draw\": %.4f}, "
+        "\"vertices_per_s\": %.1f, \"fragments_per_s\": %.1f",
+        r.name.c_str(),r.width,r.height,r.iterations,
+        (unsigned long long)r.vertices,(unsigned long long)r.fragments,
+        r.msClear,r.msDraw,
+        s>0?r.vertices/s:0.,s>0?r.fragments/s:0.);
+#if GPU_STATISTICS
+    GPUStatistics const&t = r.stats;
+    double n = r.iterations;
+    std::fprintf(f,", \"stages_ms\": {\"pull\": %.4f, \"vs\": %.4f, \"clip\": %.4f, \"setup\": %.4f, "
+        "\"raster\": %.4f, \"fs\": %.4f, \"rop\": %.4f}",
+        t.msPull/n,t.msVS/n,t.msClip/n,t.msSetup/n,t.msRaster/n,t.msFS/n,t.msROP/n);
+#else
+    std::fprintf(f,", \"stages_ms\": null");
+#endif
+    std::fprintf(f,"}%s\n",i+1<results.size()?",":"");
+  }
+  std::fprintf(f,"  ]\n}\n");
+}
+
+}
+
+int main(int argc,char*argv[]){
+  uint32_t    iterations = 10;
+  uint32_t    threads    = 0;
+  char const* jsonFile   = nullptr;
+  char const* meshFile   = nullptr;
+  char const* saveFile   = nullptr;
+  for(int i=1;i<argc;++i){
+    if(!std::strcmp(argv[i],"--iterations") && i+1<argc)iterations = (uint32_t)std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--threads") && i+1<argc)threads = (uint32_t)std::atoi(argv[++i]);
+    else if(!std::strcmp(argv[i],"--json") && i+1<argc)jsonFile = argv[++i];
+    else if(!std::strcmp(argv[i],"--mesh") && i+1<argc)meshFile = argv[++i];
+    else if(!std::strcmp(argv[i],"--save-bunny") && i+1<argc)saveFile = argv[++i];
+    else{
+      std::fprintf(stderr,"usage: %s [--iterations N] [--threads N] [--json file] [--mesh file] [--save-bunny file]\n"
+          "per stage times need gpu.cpp and the benchmark compiled with -DGPU_STATISTICS=1\n",argv[0]);
+      return 1;
+    }
+  }
+  iterations = std::max(iterations,1u);
+#if !GPU_STATISTICS
+  std::printf("per stage times are disabled, compile with -DGPU_STATISTICS=1 to report them\n");
+#endif
+
+  if(saveFile){
+    MeshFileAttribute const attributes[2] = {
+      {(uint32_t)AttributeType::VEC3,offsetof(BunnyVertex,position)},
+      {(uint32_t)AttributeType::VEC3,offsetof(BunnyVertex,normal  )},
+    };
+    if(!saveMesh(saveFile,bunnyVertices,1049,sizeof(BunnyVertex),attributes,2,bunnyIndices,6276,sizeof(VertexIndex))){
+      std::fprintf(stderr,"cannot write %s\n",saveFile);
+      return 1;
+    }
+  }
+
+  uint32_t const sizes[][2] = {{320,240},{1280,720},{1920,1080}};
+  std::vector<Result>results;
+
+  PhongMethod method;
+  method.gpu.setThreadCount(threads);
+  for(auto const&size:sizes){
+    method.gpu.createFramebuffer(size[0],size[1]);
+    results.push_back(runPhong(method,"phong_bunny",method.vao,6276,iterations));
+    printResult(results.back());
+  }
+
+  if(meshFile){
+    //mesh needs position in head 0 and normal in head 1 like the bunny
+    Mesh mesh;
+    auto start = std::chrono::steady_clock::now();
+    if(!loadMesh(method.gpu,mesh,meshFile)){
+      std::fprintf(stderr,"cannot load %s\n",meshFile);
+      return 1;
+    }
+    std::printf("%-24s %u vertices, %u indices loaded in %.3f ms\n",meshFile,mesh.nofVertices,mesh.nofIndices,elapsed(start));
+    method.gpu.createFramebuffer(1280,720);
+    results.push_back(runPhong(method,"phong_mesh",mesh.vao,mesh.drawCount(),iterations));
+    printResult(results.back());
+    deleteMesh(method.gpu,mesh);
+  }
+
+  GPU&gpu = method.gpu;
+  gpu.createFramebuffer(1280,720);
+  uint32_t w = gpu.getFramebufferWidth(),h = gpu.getFramebufferHeight();
+  results.push_back(runSynthetic(gpu,"tiny_triangles"       ,tinyTriangles(w,h),iterations));printResult(results.back());
+  results.push_back(runSynthetic(gpu,"huge_triangles"       ,hugeTriangles(w,h),iterations));printResult(results.back());
+  results.push_back(runSynthetic(gpu,"overdraw_back_to_front",overdraw(true)    ,iterations));printResult(results.back());
+  results.push_back(runSynthetic(gpu,"overdraw_front_to_back",overdraw(false)   ,iterations));printResult(results.back());
+  results.push_back(runSynthetic(gpu,"near_clipped"         ,nearClipped(w,h)  ,iterations));printResult(results.back());
+
+  if(jsonFile){
+    std::FILE*f = std::fopen(jsonFile,"w");
+    if(!f){
+      std::fprintf(stderr,"cannot open %s\n",jsonFile);
+      return 1;
+    }
+    writeJson(f,results,gpu.getThreadCount());
+    std::fclose(f);
+  }
+  return 0;
+}
@@ -8,8 +8,43 @@
 #include <student/gpu.hpp>
 #include <iostream>
 #include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <string.h>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GPU_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GPU_TARGET_AVX2
+#else
+#define GPU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define GPU_X86 0
+#endif
+
+#if GPU_STATISTICS
+#include <chrono>
+#define GPU_STAT(x) x
+typedef std::chrono::steady_clock::time_point stat_cas;
+static stat_cas statTeraz(){
+    return std::chrono::steady_clock::now();
+}
+/// returns milliseconds elapsed since od and moves od to the current time
+static double statMs(stat_cas& od){
+    stat_cas teraz = statTeraz();
+    double ms = std::chrono::duration<double, std::milli>(teraz - od).count();
+    od = teraz;
+    return ms;
+}
+#else
+#define GPU_STAT(x)
+#endif
+
+static GPU::pokrytie8 vyberPokrytie8();
+
  
 
 
@@ -25,6 +60,9 @@ GPU::GPU(){
     aktiv_vertex = emptyID;
     aktiv_prog = emptyID;
     buf_id.clear();
+    setThreadCount(0);
+    setVertexCacheSize(256);
+    pokrytie = vyberPokrytie8();
 }
 
 /**
@@ -32,12 +70,23 @@ GPU::GPU(){
  */
 GPU::~GPU(){
   /// \todo Zde můžete dealokovat/deinicializovat grafickou kartu
-	for(int i = 0; i<buffer_list.size();++i)
+    stopSubmitThread();
+    stopWorkers();
+	for(int i = 0; i<buf_bloky.size();++i)
+	{
+		if(buf_bloky[i].surovy != NULL)
+			operator delete[](buf_bloky[i].surovy);
+	}
+	for(int i = 0; i<volne_velke.size();++i)
+	{
+		operator delete[](volne_velke[i].surovy);
+	}
+	for(int i = 0; i<slaby.size();++i)
 	{
-		if(buffer_list[i] != NULL)
-			delete [] (char*)buffer_list[i];
+		operator delete[](slaby[i]);
 	}
 	buffer_list.clear();
+	buf_bloky.clear();
 	for(int i = 0; i<vertex_list.size();++i)
 	{
 		if(vertex_list[i] != NULL)
@@ -51,10 +100,315 @@ GPU::~GPU(){
 			delete program_list[i];
 	}
 	program_list.clear();
+	for(int i = 0; i<uniform_bloky.size();++i)
+	{
+		if(uniform_bloky[i] != NULL)
+			delete uniform_bloky[i];
+	}
+	uniform_bloky.clear();
 
 
 
 	
+}
+
+/**
+ * @brief This function sets number of threads used for rasterization.
+ *
+ * @param nofThreads number of threads including the calling thread, 0 selects number of hardware threads
+ */
+void GPU::setThreadCount(uint32_t nofThreads){
+    if (nofThreads == 0)
+    {
+        nofThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    finish();
+    stopWorkers();
+    pamat_vlakien.resize(nofThreads);
+    for (uint32_t i = 1; i < nofThreads; i++)
+    {
+        vlakna.push_back(std::thread(&GPU::workerLoop, this, i, generacia));
+    }
+}
+
+/**
+ * @brief This function returns number of threads used for rasterization.
+ *
+ * @return number of threads including the calling thread
+ */
+uint32_t GPU::getThreadCount(){
+    return (uint32_t)vlakna.size() + 1;
+}
+
+/**
+ * @brief This function sets number of entries of post-transform vertex cache.
+ *
+ * The cache is direct mapped and it is used only for indexed draws.
+ *
+ * @param nofEntries number of entries, it is rounded up to power of two, 0 disables the cache
+ */
+void GPU::setVertexCacheSize(uint32_t nofEntries){
+    finish();
+    uint32_t velkost = 0;
+    if (nofEntries > 0)
+    {
+        velkost = 1;
+        while (velkost < nofEntries)
+        {
+            velkost *= 2;
+        }
+    }
+    cache_tag.assign(velkost, (uint64_t)prazdny_tag);
+    cache_vrcholy.assign(velkost, 0);
+}
+
+/**
+ * @brief This function returns number of vertices that were taken from post-transform vertex cache.
+ *
+ * @return number of cache hits since the last reset
+ */
+uint64_t GPU::getVertexCacheHits(){
+    finish();
+    return cache_hits;
+}
+
+/**
+ * @brief This function returns number of vertices that had to be processed by vertex shader in indexed draws.
+ *
+ * @return number of cache misses since the last reset
+ */
+uint64_t GPU::getVertexCacheMisses(){
+    finish();
+    return cache_misses;
+}
+
+/**
+ * @brief This function resets hit/miss counters of post-transform vertex cache.
+ */
+void GPU::resetVertexCacheCounters(){
+    finish();
+    cache_hits = 0;
+    cache_misses = 0;
+}
+
+/**
+ * @brief This function enables or disables rasterization in 2x2 quads.
+ *
+ * Quads are always used when the program has batched fragment shader.
+ * With ordinary fragment shader, the image is the same as without quads.
+ *
+ * @param enable true enables quads
+ */
+void GPU::setQuadShading(bool enable){
+    finish();
+    quad_shading = enable;
+}
+
+/**
+ * @brief This function returns if rasterization in 2x2 quads is enabled.
+ *
+ * @return true if quads are enabled
+ */
+bool GPU::getQuadShading(){
+    return quad_shading;
+}
+
+/**
+ * @brief This function sets size of batches of triangles processed by drawTriangles.
+ *
+ * Each batch goes through the whole pipeline (vertex shader, clipping, setup,
+ * rasterization) before the next one starts, so memory used by a draw call is
+ * bounded by the batch size and the data are still in cache when they are rasterized.
+ * Post-transform vertex cache is emptied at the start of every batch.
+ *
+ * @param nofTriangles number of triangles of one batch, 0 processes whole draw call at once
+ */
+void GPU::setDrawBatchSize(uint32_t nofTriangles){
+    finish();
+    velkost_davky = nofTriangles;
+}
+
+/**
+ * @brief This function returns size of batches of triangles processed by drawTriangles.
+ *
+ * @return number of triangles of one batch, 0 means whole draw call
+ */
+uint32_t GPU::getDrawBatchSize(){
+    return velkost_davky;
+}
+
+/**
+ * @brief This function enables automatic narrowing of index buffers.
+ *
+ * When enabled, the first draw with a vertex puller checks its 32 bit or 16 bit indices
+ * and if all of them fit into a narrower type, the draws read a narrowed copy.
+ * The copy is rebuilt after the index buffer is changed by setBufferData or unmapBuffer.
+ *
+ * @param enable true = narrow indices
+ */
+void GPU::setIndexNarrowing(bool enable){
+    finish();
+    index_narrowing = enable;
+}
+
+/**
+ * @brief This function returns if index buffers are narrowed automatically.
+ *
+ * @return true, if index narrowing is enabled
+ */
+bool GPU::getIndexNarrowing(){
+    return index_narrowing;
+}
+
+/**
+ * @brief This function enables or disables early depth test.
+ *
+ * With early depth test, fragments are depth tested before the fragment shader
+ * is executed and triangles or 8 pixel spans lying behind the coarse depth buffer are
+ * rejected without rasterization.
+ * Fragment shader cannot write depth (OutFragment contains only color), so the result
+ * is the same as with late depth test. It is enabled by default.
+ *
+ * @param enable true enables early depth test
+ */
+void GPU::setEarlyDepthTest(bool enable){
+    finish();
+    early_z = enable;
+}
+
+/**
+ * @brief This function returns if early depth test is enabled.
+ *
+ * @return true if early depth test is enabled
+ */
+bool GPU::getEarlyDepthTest(){
+    return early_z;
+}
+
+/**
+ * @brief This function selects which triangles are discarded according to their facing.
+ *
+ * @param mode CullFace::NONE (default), CullFace::FRONT, CullFace::BACK or CullFace::FRONT_AND_BACK
+ */
+void GPU::setCullFace(CullFace mode){
+    finish();
+    cull_face = mode;
+}
+
+/**
+ * @brief This function selects winding of front facing triangles.
+ *
+ * @param mode FrontFace::CCW (default) or FrontFace::CW, winding is measured in window coordinates
+ */
+void GPU::setFrontFace(FrontFace mode){
+    finish();
+    front_face = mode;
+}
+
+/**
+ * @brief This function returns statistics of draw calls since the last reset.
+ *
+ * Statistics are collected only when gpu.cpp is compiled with GPU_STATISTICS=1,
+ * otherwise all values are zero.
+ *
+ * @return accumulated statistics, valid until the next draw or reset
+ */
+GPUStatistics const& GPU::getStatistics(){
+    finish();
+    return statistiky;
+}
+
+/**
+ * @brief This function resets statistics of draw calls, it is meant to be called once per frame.
+ */
+void GPU::resetStatistics(){
+    finish();
+    statistiky = GPUStatistics();
+}
+
+/**
+ * @brief This function stops and joins all worker threads.
+ */
+void GPU::stopWorkers(){
+    {
+        std::lock_guard<std::mutex> lock(zamok);
+        ukoncit = true;
+    }
+    start_cv.notify_all();
+    for (int i = 0; i < vlakna.size(); i++)
+    {
+        vlakna[i].join();
+    }
+    vlakna.clear();
+    ukoncit = false;
+}
+
+/**
+ * @brief This function runs count tasks on the worker pool and waits for all of them.
+ *
+ * @param fn task, gets index of the task and index of the thread
+ * @param count number of tasks
+ */
+void GPU::runParallel(uloha fn,uint32_t count){
+    akt_uloha = fn;
+    pocet_uloh = count;
+    dalsia_uloha = 0;
+    if (vlakna.size() == 0 || count <= 1)
+    {
+        processTasks(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(zamok);
+        aktivne = (uint32_t)vlakna.size();
+        generacia++;
+    }
+    start_cv.notify_all();
+    processTasks(0);
+    std::unique_lock<std::mutex> lock(zamok);
+    koniec_cv.wait(lock, [this] { return aktivne == 0; });
+}
+
+/**
+ * @brief This function takes tasks of the current job until there are none left.
+ *
+ * @param vlakno index of the thread
+ */
+void GPU::processTasks(uint32_t vlakno){
+    uint32_t i;
+    while ((i = dalsia_uloha.fetch_add(1)) < pocet_uloh)
+    {
+        (this->*akt_uloha)(i, vlakno);
+    }
+}
+
+/**
+ * @brief Main loop of one worker thread.
+ *
+ * @param vlakno index of the thread
+ * @param videna last job generation that the thread has already seen
+ */
+void GPU::workerLoop(uint32_t vlakno,uint64_t videna){
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(zamok);
+            start_cv.wait(lock, [&] { return ukoncit || generacia != videna; });
+            if (ukoncit)
+            {
+                return;
+            }
+            videna = generacia;
+        }
+        processTasks(vlakno);
+        {
+            std::lock_guard<std::mutex> lock(zamok);
+            if (--aktivne == 0)
+            {
+                koniec_cv.notify_one();
+            }
+        }
+    }
 }
 
 /// @}
@@ -75,27 +429,66 @@ BufferID GPU::createBuffer(uint64_t size) {
   /// Velikost bufferu je v parameteru size (v bajtech).<br>
   /// Funkce by měla vrátit unikátní identifikátor identifikátor bufferu.<br>
   /// Na grafické kartě by mělo být možné alkovat libovolné množství bufferů o libovolné velikosti.<br>
+    // pamat je z areny, zarovnana na bufferAlignment bajtov
+    blok b = allocBlock(size);
+    b.velkost = size;
+  return storeBuffer(b); 
+}
+
+/**
+ * @brief This function creates buffer that uses memory of the caller.
+ *
+ * Data are not copied, the memory (e.g. a memory mapped file) is used in place.
+ * It must stay valid until the buffer is deleted, deleteBuffer does not free it.
+ * Read only memory must not be written by setBufferData or mapBuffer.
+ *
+ * @param data memory of the buffer, alignment to bufferAlignment bytes is recommended
+ * @param size size of the memory in bytes
+ *
+ * @return buffer identificator
+ */
+BufferID GPU::createBufferFromMemory(void* data,uint64_t size){
+    blok b;
+    b.data = data;
+    b.kapacita = size;
+    b.velkost = size;
+    b.externy = true;
+    return storeBuffer(b);
+}
+
+/**
+ * @brief This function assigns identificator to memory block of a new buffer.
+ *
+ * @param b memory of the buffer
+ *
+ * @return buffer identificator, freed identificators are reused
+ */
+BufferID GPU::storeBuffer(blok const& b){
     BufferID id;
     if (buf_id.size() == 0)
     {
+        // rast zoznamu presuva pamat, ktoru citaju odoslane prikazy
+        finish();
         id = buffer_list.size();
-        void* prvok = operator new [] (size);
-        buffer_list.push_back(prvok);
+        buffer_list.push_back(b.data);
+        buf_bloky.push_back(b);
     }
     else
     {
             id = buf_id.back();
             buf_id.pop_back();
-            void* prvok = operator new[](size);
-            buffer_list[id] = prvok;
+            buffer_list[id] = b.data;
+            buf_bloky[id] = b;
     }
-    
-  return id; 
+    return id;
 }
 
 /**
  * @brief This function frees allocated buffer on GPU.
  *
+ * Pending asynchronous submissions are finished first, they may still read the buffer.
+ * The buffer must not be mapped, debug build checks it by assert.
+ *
  * @param buffer buffer identificator
  */
 void GPU::deleteBuffer(BufferID buffer) {
@@ -103,7 +496,12 @@ void GPU::deleteBuffer(BufferID buffer) {
   /// Buffer pro smazání je vybrán identifikátorem v parameteru "buffer".
   /// Po uvolnění bufferu je identifikátor volný a může být znovu použit při vytvoření nového bufferu.
   
-    delete [] (char*)buffer_list[buffer];
+    // namapovany buffer by volajucemu nechal neplatny ukazovatel
+    assert(!buf_bloky[buffer].mapovany);
+    finish();
+    invalidateIndexCopies(buffer);
+    freeBlock(buf_bloky[buffer]);
+    buf_bloky[buffer] = blok();
     buffer_list[buffer] = NULL;
     buf_id.push_back(buffer);
         
@@ -114,6 +512,8 @@ void GPU::deleteBuffer(BufferID buffer) {
 /**
  * @brief This function uploads data to selected buffer on the GPU
  *
+ * Pending asynchronous submissions are finished first, they may still read the buffer.
+ *
  * @param buffer buffer identificator
  * @param offset specifies the offset into the buffer's data
  * @param size specifies the size of buffer that will be uploaded
@@ -121,8 +521,9 @@ void GPU::deleteBuffer(BufferID buffer) {
  */
 void GPU::setBufferData(BufferID buffer, uint64_t offset, uint64_t size, void const* data) {
     // riesenie s posunom pri ukazovateli na void: https://stackoverflow.com/questions/6449935/increment-void-pointer-by-one-byte-by-two
-   
+    finish();
     memcpy(static_cast<char*>(buffer_list[buffer]) + offset, data, size);
+    invalidateIndexCopies(buffer);
 }
 
 /**
@@ -142,6 +543,64 @@ void GPU::getBufferData(BufferID buffer,
     memcpy( data, static_cast<char*>(buffer_list[buffer]) + offset, size);
 }
 
+/**
+ * @brief This function maps range of buffer to the address space of the caller.
+ *
+ * The returned pointer points directly to the memory of the buffer, nothing is copied.
+ * Pending asynchronous submissions are finished first, so the range can be
+ * accessed safely until unmapBuffer. The range must lie inside of the buffer and
+ * the buffer must not be mapped already, debug build checks both by assert.
+ *
+ * @param buffer buffer identificator
+ * @param offset offset of the range in bytes
+ * @param size size of the range in bytes
+ * @param access combination of BufferAccess flags
+ *
+ * @return pointer to the first byte of the range
+ */
+void* GPU::mapBuffer(BufferID buffer,uint64_t offset,uint64_t size,uint32_t access){
+    finish();
+    blok& b = buf_bloky[buffer];
+    // rozsah musi lezat v bufferi a buffer nesmie byt uz namapovany
+    assert(offset <= b.velkost && size <= b.velkost - offset);
+    assert(!b.mapovany);
+    b.mapovany = true;
+    char* data = static_cast<char*>(b.data) + offset;
+#ifndef NDEBUG
+    // v ladiacom preklade sa zahodeny obsah prepise, aby sa citanie starych dat prejavilo
+    if ((access & MAP_INVALIDATE) && !(access & MAP_READ) && !b.externy)
+    {
+        memset(data, 0xcd, size);
+    }
+#endif
+    return data;
+}
+
+/**
+ * @brief This function ends mapping of buffer started by mapBuffer.
+ *
+ * The buffer must exist and be mapped, debug build checks it by assert.
+ *
+ * @param buffer buffer identificator
+ */
+void GPU::unmapBuffer(BufferID buffer){
+    assert(isBuffer(buffer) && buf_bloky[buffer].mapovany);
+    buf_bloky[buffer].mapovany = false;
+    // zapisy cez mapovanie mohli zmenit indexy
+    invalidateIndexCopies(buffer);
+}
+
+/**
+ * @brief This function tests if buffer is mapped.
+ *
+ * @param buffer buffer identificator
+ *
+ * @return true, if buffer is mapped by mapBuffer
+ */
+bool GPU::isBufferMapped(BufferID buffer){
+    return isBuffer(buffer) && buf_bloky[buffer].mapovany;
+}
+
 /**
  * @brief This function tests if buffer exists
  *
@@ -167,6 +626,113 @@ bool GPU::isBuffer(BufferID buffer) {
     }
 }   
 
+/**
+ * @brief This function allocates memory aligned to bufferAlignment bytes from the system.
+ *
+ * @param size size in bytes
+ * @param surovy returns pointer that has to be passed to operator delete[]
+ *
+ * @return aligned pointer
+ */
+void* GPU::allocAligned(uint64_t size,void*& surovy){
+    surovy = operator new[](size + bufferAlignment);
+    uintptr_t adresa = (reinterpret_cast<uintptr_t>(surovy) + bufferAlignment - 1) & ~(uintptr_t)(bufferAlignment - 1);
+    return reinterpret_cast<void*>(adresa);
+}
+
+/**
+ * @brief This function takes memory block for a buffer from the arena.
+ *
+ * Sizes up to 2^maxTrieda bytes are rounded to a power of two and cut from shared slabs,
+ * larger blocks are allocated separately and reused by buffers of similar size.
+ * Freed blocks are kept for reuse, so creating and deleting buffers does not call
+ * the system allocator in a steady state.
+ *
+ * @param size size of buffer in bytes
+ *
+ * @return block aligned to bufferAlignment bytes
+ */
+GPU::blok GPU::allocBlock(uint64_t size){
+    blok b;
+    if (size <= ((uint64_t)1 << maxTrieda))
+    {
+        uint32_t trieda = minTrieda;
+        while (((uint64_t)1 << trieda) < size)
+        {
+            trieda++;
+        }
+        std::vector<void*>& volne = volne_bloky[trieda - minTrieda];
+        if (volne.empty())
+        {
+            // novy slab sa cely rozdeli na bloky danej triedy
+            void* surovy;
+            char* slab = static_cast<char*>(allocAligned(velkostSlabu, surovy));
+            slaby.push_back(surovy);
+            for (uint64_t o = velkostSlabu; o > 0; o -= (uint64_t)1 << trieda)
+            {
+                volne.push_back(slab + o - ((uint64_t)1 << trieda));
+            }
+        }
+        b.data = volne.back();
+        volne.pop_back();
+        b.kapacita = (uint64_t)1 << trieda;
+        b.trieda = trieda;
+        return b;
+    }
+    // najmensi volny velky blok, ktory neplytva viac ako polovicou
+    int najlepsi = -1;
+    for (int i = 0; i < (int)volne_velke.size(); i++)
+    {
+        uint64_t k = volne_velke[i].kapacita;
+        if (k >= size && k / 2 <= size && (najlepsi < 0 || k < volne_velke[najlepsi].kapacita))
+        {
+            najlepsi = i;
+        }
+    }
+    if (najlepsi >= 0)
+    {
+        b = volne_velke[najlepsi];
+        volne_velke_bajty -= b.kapacita;
+        volne_velke[najlepsi] = volne_velke.back();
+        volne_velke.pop_back();
+        return b;
+    }
+    b.kapacita = (size + 4095) & ~(uint64_t)4095;
+    b.data = allocAligned(b.kapacita, b.surovy);
+    return b;
+}
+
+/**
+ * @brief This function returns memory block of a buffer to the arena.
+ *
+ * @param b block returned by allocBlock
+ */
+void GPU::freeBlock(blok const& b){
+    if (b.externy)
+    {
+        return;
+    }
+    if (b.surovy == NULL)
+    {
+        volne_bloky[b.trieda - minTrieda].push_back(b.data);
+        return;
+    }
+    // ulozi sa len pamat, stav bufferu (mapovanie, uzke indexy) sa na dalsi buffer neprenasa
+    blok volny;
+    volny.data = b.data;
+    volny.surovy = b.surovy;
+    volny.kapacita = b.kapacita;
+    volne_velke.push_back(volny);
+    volne_velke_bajty += b.kapacita;
+    // velke bloky sa drzia len do limitu, najstarsie sa vratia systemu
+    while (volne_velke_bajty > maxVolnychVelkych)
+    {
+        volne_velke_bajty -= volne_velke.front().kapacita;
+        operator delete[](volne_velke.front().surovy);
+        volne_velke.erase(volne_velke.begin());
+    }
+}
+
 /// @}
 
 /**
@@ -187,6 +753,8 @@ ObjectID GPU::createVertexPuller     (){
     
     if (ver_id.size() == 0)
     {
+        // rast zoznamu presuva pamat, ktoru citaju odoslane prikazy
+        finish();
         id = vertex_list.size();
         vertex_list.push_back((tabulka*)new tabulka);
     }
@@ -202,12 +770,15 @@ ObjectID GPU::createVertexPuller     (){
 /**
  * @brief This function deletes vertex puller settings
  *
+ * Pending asynchronous submissions are finished first, they may still use the vertex puller.
+ *
  * @param vao vertex puller identificator
  */
 void     GPU::deleteVertexPuller     (VertexPullerID vao){
   /// \todo Tato funkce by měla odstranit tabulku s nastavení pro vertex puller.<br>
   /// Parameter "vao" obsahuje identifikátor tabulky s nastavením.<br>
   /// Po uvolnění nastavení je identifiktátor volný a může být znovu použit.<br>
+    finish();
     delete vertex_list[vao];
     vertex_list[vao] = NULL;
     ver_id.push_back(vao);
@@ -231,10 +802,12 @@ void     GPU::setVertexPullerHead    (VertexPullerID vao,uint32_t head,Attribute
   /// Parametr "stride" nastaví krok čtecí hlavy.<br>
   /// Parametr "offset" nastaví počáteční pozici čtecí hlavy.<br>
   /// Parametr "buffer" vybere buffer, ze kterého bude čtecí hlava číst.<br>
+    finish();
     vertex_list[vao]->hlavy[head].type = type;
     vertex_list[vao]->hlavy[head].stride = stride;
     vertex_list[vao]->hlavy[head].offset = offset;
     vertex_list[vao]->hlavy[head].buffer = buffer;
+    vertex_list[vao]->plan_platny = false;
 }
 
 /**
@@ -249,9 +822,12 @@ void     GPU::setVertexPullerIndexing(VertexPullerID vao,IndexType type,BufferID
   /// Parametr "vao" vybírá tabulku s nastavením.<br>
   /// Parametr "type" volí typ indexu, který je uložený v bufferu.<br>
   /// Parametr "buffer" volí buffer, ve kterém jsou uloženy indexy.<br>
+    finish();
     vertex_list[vao]->index.type = type;
     vertex_list[vao]->index.buffer = buffer;
     vertex_list[vao]->ind = true;
+    vertex_list[vao]->uzke_platne = false;
+    vertex_list[vao]->uzke_indexy.clear();
 }
 
 /**
@@ -265,7 +841,9 @@ void     GPU::enableVertexPullerHead (VertexPullerID vao,uint32_t head){
   /// Pokud je čtecí hlava povolena, hodnoty z bufferu se budou kopírovat do atributu vrcholů vertex shaderu.<br>
   /// Parametr "vao" volí tabulku s nastavením vertex pulleru (vybírá vertex puller).<br>
   /// Parametr "head" volí čtecí hlavu.<br>
+    finish();
     vertex_list[vao]->hlavy[head].enable = true;
+    vertex_list[vao]->plan_platny = false;
 }
 
 /**
@@ -278,7 +856,9 @@ void     GPU::disableVertexPullerHead(VertexPullerID vao,uint32_t head){
   /// \todo Tato funkce zakáže čtecí hlavu daného vertex pulleru.<br>
   /// Pokud je čtecí hlava zakázána, hodnoty z bufferu se nebudou kopírovat do atributu vrcholu.<br>
   /// Parametry "vao" a "head" vybírají vertex puller a čtecí hlavu.<br>
+    finish();
     vertex_list[vao]->hlavy[head].enable = false;
+    vertex_list[vao]->plan_platny = false;
 }
 
 /**
@@ -289,6 +869,7 @@ void     GPU::disableVertexPullerHead(VertexPullerID vao,uint32_t head){
 void     GPU::bindVertexPuller       (VertexPullerID vao){
   /// \todo Tato funkce aktivuje nastavení vertex pulleru.<br>
   /// Pokud je daný vertex puller aktivován, atributy z bufferů jsou vybírány na základě jeho nastavení.<br>
+    finish();
     aktiv_vertex = vao;
 }
 
@@ -298,6 +879,7 @@ void     GPU::bindVertexPuller       (VertexPullerID vao){
 void     GPU::unbindVertexPuller     (){
   /// \todo Tato funkce deaktivuje vertex puller.
   /// To většinou znamená, že se vybere neexistující "emptyID" vertex puller.
+    finish();
     aktiv_vertex = emptyID;
 }
 
@@ -344,6 +926,8 @@ ProgramID        GPU::createProgram         (){
     ObjectID id;
   if (pro_id.size() == 0)
   {
+      // rast zoznamu presuva pamat, ktoru citaju odoslane prikazy
+      finish();
       id = program_list.size();
       program_list.push_back((program*)new program);
   }
@@ -360,12 +944,15 @@ ProgramID        GPU::createProgram         (){
 /**
  * @brief This function deletes shader program
  *
+ * Pending asynchronous submissions are finished first, they may still use the program.
+ *
  * @param prg shader program id
  */
 void             GPU::deleteProgram         (ProgramID prg){
   /// \todo Tato funkce by měla smazat vybraný shader program.<br>
   /// Funkce smaže nastavení shader programu.<br>
   /// Identifikátor programu se stane volným a může být znovu využit.<br>
+    finish();
     delete program_list[prg];
     program_list[prg] = NULL;
     pro_id.push_back(prg);
@@ -380,8 +967,40 @@ void             GPU::deleteProgram         (ProgramID prg){
  */
 void             GPU::attachShaders         (ProgramID prg,VertexShader vs,FragmentShader fs){
   /// \todo Tato funkce by měla připojít k vybranému shader programu vertex a fragment shader.
+    finish();
     program_list[prg]->vs = vs;
     program_list[prg]->fs = fs;
+    program_list[prg]->fs_batch = NULL;
+}
+
+/**
+ * @brief This function attaches batched fragment shader to shader program.
+ *
+ * Batched shader is used instead of the fragment shader attached by attachShaders,
+ * it receives fragments in 2x2 quads (see FragmentShaderBatch), so it can
+ * process several pixels at once and compute derivatives by dFdx and dFdy.
+ * attachShaders removes batched shader of the program.
+ *
+ * @param prg shader program
+ * @param fs batched fragment shader, NULL removes it
+ */
+void             GPU::attachFragmentShaderBatch(ProgramID prg,FragmentShaderBatch fs){
+    finish();
+    program_list[prg]->fs_batch = fs;
+}
+
+/**
+ * @brief This function attaches uniform preamble to shader program.
+ *
+ * Preamble is called once per draw after uniform blocks are applied. It stays attached
+ * when shaders are changed by attachShaders.
+ *
+ * @param prg shader program
+ * @param preamble preamble, NULL = none
+ */
+void             GPU::attachUniformPreamble (ProgramID prg,UniformPreamble preamble){
+    finish();
+    program_list[prg]->preambula = preamble;
 }
 
 /**
@@ -398,6 +1017,7 @@ void             GPU::setVS2FSType          (ProgramID prg,uint32_t attrib,Attri
   /// Tyto atributy obsahují interpolované hodnoty vertex atributů.<br>
   /// Tato funkce vybere jakého typu jsou tyto interpolované atributy.<br>
   /// Bez jakéhokoliv nastavení jsou atributy prázdne AttributeType::EMPTY<br>
+    finish();
     
     program_list[prg]->atr_num.push_back((int)attrib);
     program_list[prg]->type.push_back((int)type);
@@ -413,6 +1033,7 @@ void             GPU::setVS2FSType          (ProgramID prg,uint32_t attrib,Attri
  */
 void             GPU::useProgram            (ProgramID prg){
   /// \todo tato funkce by měla vybrat aktivní shader program.
+    finish();
     aktiv_prog = prg;
 }
 
@@ -452,6 +1073,7 @@ void             GPU::programUniform1f      (ProgramID prg,uint32_t uniformId,fl
   /// Parametr "prg" vybírá shader program.<br>
   /// Parametr "uniformId" vybírá uniformní proměnnou. Maximální počet uniformních proměnných je uložen v programné \link maxUniforms \endlink.<br>
   /// Parametr "d" obsahuje data (1 float).<br>
+    finish();
     program_list[prg]->premenne.uniform[uniformId].v1 = d;
 }
 
@@ -465,6 +1087,7 @@ void             GPU::programUniform1f      (ProgramID prg,uint32_t uniformId,fl
 void             GPU::programUniform2f      (ProgramID prg,uint32_t uniformId,glm::vec2 const&d){
   /// \todo tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 2 floaty.
+    finish();
     program_list[prg]->premenne.uniform[uniformId].v2 = d;
 }
 
@@ -478,6 +1101,7 @@ void             GPU::programUniform2f      (ProgramID prg,uint32_t uniformId,gl
 void             GPU::programUniform3f      (ProgramID prg,uint32_t uniformId,glm::vec3 const&d){
   /// \todo tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 3 floaty.
+    finish();
     program_list[prg]->premenne.uniform[uniformId].v3 = d;
 }
 
@@ -491,6 +1115,7 @@ void             GPU::programUniform3f      (ProgramID prg,uint32_t uniformId,gl
 void             GPU::programUniform4f      (ProgramID prg,uint32_t uniformId,glm::vec4 const&d){
   /// \todo tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 4 floaty.
+    finish();
     program_list[prg]->premenne.uniform[uniformId].v4 = d;
 }
 
@@ -504,19 +1129,197 @@ void             GPU::programUniform4f      (ProgramID prg,uint32_t uniformId,gl
 void             GPU::programUniformMatrix4f(ProgramID prg,uint32_t uniformId,glm::mat4 const&d){
   /// \todo tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává matici 4x4 (16 floatů).
+    finish();
     program_list[prg]->premenne.uniform[uniformId].m4 = d;
 }
 
-/// @}
-
-
-
-
-
-/** \addtogroup framebuffer_tasks 04. Implementace obslužných funkcí pro framebuffer
- * @{
- */
-
+/**
+ * @brief This function creates uniform block.
+ *
+ * Uniform block holds maxUniforms uniforms, it can be bound to many programs
+ * and its values are used by all of them, so shared data (camera, light, ...)
+ * are updated once per frame instead of once per program.
+ *
+ * @return identificator of uniform block
+ */
+UniformBlockID   GPU::createUniformBlock    (){
+    UniformBlockID id;
+    if (ubo_id.size() == 0)
+    {
+        // rast zoznamu presuva pamat, ktoru citaju odoslane prikazy
+        finish();
+        id = uniform_bloky.size();
+        uniform_bloky.push_back(new Uniforms);
+    }
+    else
+    {
+        id = ubo_id.back();
+        ubo_id.pop_back();
+        uniform_bloky[id] = new Uniforms;
+    }
+    return id;
+}
+
+/**
+ * @brief This function deletes uniform block and unbinds it from all programs.
+ *
+ * Pending asynchronous submissions are finished first, they may still read the block.
+ *
+ * @param block uniform block
+ */
+void             GPU::deleteUniformBlock    (UniformBlockID block){
+    finish();
+    for (uint32_t i = 0; i < program_list.size(); i++)
+    {
+        if (program_list[i] != NULL)
+        {
+            unbindUniformBlock(i, block);
+        }
+    }
+    delete uniform_bloky[block];
+    uniform_bloky[block] = NULL;
+    ubo_id.push_back(block);
+}
+
+/**
+ * @brief This function tests if uniform block exists.
+ *
+ * @param block uniform block
+ *
+ * @return true, if uniform block exists
+ */
+bool             GPU::isUniformBlock        (UniformBlockID block){
+    return block != emptyID && block < uniform_bloky.size() && uniform_bloky[block] != NULL;
+}
+
+/**
+ * @brief This function sets uniform value of uniform block (1 float).
+ *
+ * @param block uniform block
+ * @param uniformId index of uniform inside of block
+ * @param d value of uniform variable
+ */
+void             GPU::uniformBlock1f        (UniformBlockID block,uint32_t uniformId,float     const&d){
+    finish();
+    uniform_bloky[block]->uniform[uniformId].v1 = d;
+}
+
+/**
+ * @brief This function sets uniform value of uniform block (2 floats).
+ *
+ * @param block uniform block
+ * @param uniformId index of uniform inside of block
+ * @param d value of uniform variable
+ */
+void             GPU::uniformBlock2f        (UniformBlockID block,uint32_t uniformId,glm::vec2 const&d){
+    finish();
+    uniform_bloky[block]->uniform[uniformId].v2 = d;
+}
+
+/**
+ * @brief This function sets uniform value of uniform block (3 floats).
+ *
+ * @param block uniform block
+ * @param uniformId index of uniform inside of block
+ * @param d value of uniform variable
+ */
+void             GPU::uniformBlock3f        (UniformBlockID block,uint32_t uniformId,glm::vec3 const&d){
+    finish();
+    uniform_bloky[block]->uniform[uniformId].v3 = d;
+}
+
+/**
+ * @brief This function sets uniform value of uniform block (4 floats).
+ *
+ * @param block uniform block
+ * @param uniformId index of uniform inside of block
+ * @param d value of uniform variable
+ */
+void             GPU::uniformBlock4f        (UniformBlockID block,uint32_t uniformId,glm::vec4 const&d){
+    finish();
+    uniform_bloky[block]->uniform[uniformId].v4 = d;
+}
+
+/**
+ * @brief This function sets uniform value of uniform block (matrix 4x4).
+ *
+ * @param block uniform block
+ * @param uniformId index of uniform inside of block
+ * @param d value of uniform variable
+ */
+void             GPU::uniformBlockMatrix4f  (UniformBlockID block,uint32_t uniformId,glm::mat4 const&d){
+    finish();
+    uniform_bloky[block]->uniform[uniformId].m4 = d;
+}
+
+/**
+ * @brief This function binds uniform block to program.
+ *
+ * Uniform i of the block is seen by shaders of the program as uniform firstUniform + i.
+ * Values of the block are taken at every draw, they override values set by programUniform*.
+ * Binding the same block again replaces the previous binding.
+ *
+ * @param prg shader program
+ * @param block uniform block
+ * @param firstUniform first uniform of the program that is taken from the block
+ * @param nofUniforms number of uniforms taken from the block
+ */
+void             GPU::bindUniformBlock      (ProgramID prg,UniformBlockID block,uint32_t firstUniform,uint32_t nofUniforms){
+    finish();
+    unbindUniformBlock(prg, block);
+    program::vazba v;
+    v.blok = block;
+    v.prvy = firstUniform;
+    v.pocet = firstUniform < maxUniforms ? std::min(nofUniforms, maxUniforms - firstUniform) : 0;
+    program_list[prg]->vazby.push_back(v);
+}
+
+/**
+ * @brief This function unbinds uniform block from program.
+ *
+ * Uniforms of the program keep the last values of the block.
+ *
+ * @param prg shader program
+ * @param block uniform block
+ */
+void             GPU::unbindUniformBlock    (ProgramID prg,UniformBlockID block){
+    finish();
+    std::vector<program::vazba>& vazby = program_list[prg]->vazby;
+    for (uint32_t i = 0; i < vazby.size(); i++)
+    {
+        if (vazby[i].blok == block)
+        {
+            vazby.erase(vazby.begin() + i);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief This function copies values of bound uniform blocks to uniforms of program.
+ *
+ * It runs once per draw, only the bound ranges are copied.
+ *
+ * @param prog shader program
+ */
+void             GPU::applyUniformBlocks    (program* prog){
+    for (uint32_t i = 0; i < prog->vazby.size(); i++)
+    {
+        program::vazba const& v = prog->vazby[i];
+        memcpy(&prog->premenne.uniform[v.prvy], &uniform_bloky[v.blok]->uniform[0], sizeof(Attribute) * v.pocet);
+    }
+}
+
+/// @}
+
+
+
+
+
+/** \addtogroup framebuffer_tasks 04. Implementace obslužných funkcí pro framebuffer
+ * @{
+ */
+
 /**
  * @brief This function creates framebuffer on GPU.
  *
@@ -531,10 +1334,12 @@ void GPU::createFramebuffer      (uint32_t width,uint32_t height){
   /// Hloubkový pixel obsahuje 1 x float - to reprezentuje hloubku.<br>
   /// Nultý pixel framebufferu je vlevo dole.<br>
     //std::cout << width <<"    " <<height << std::endl;
+    finish();
     myframe.w = width;
     myframe.h = height;
     myframe.color.resize((4 * (int)width * (int)height));
     myframe.hlbka.resize((int)width * (int)height);
+    resizeHiZ();
     //std::cout << myframe.color.size() << "    " << myframe.hlbka.size() << std::endl;
 }
 
@@ -553,12 +1358,14 @@ void GPU::deleteFramebuffer      (){
  */
 void     GPU::resizeFramebuffer(uint32_t width,uint32_t height){
   /// \todo Tato funkce by měla změnit velikost framebuffer.
+    finish();
     if (myframe.w != width || myframe.h != height)
     {
         myframe.w = width;
         myframe.h = height;
         myframe.color.resize(4 * (int)width * (int)height);
         myframe.hlbka.resize((int)width * (int)height);
+        resizeHiZ();
     }
 }
 
@@ -569,6 +1376,8 @@ void     GPU::resizeFramebuffer(uint32_t width,uint32_t height){
  */
 uint8_t* GPU::getFramebufferColor  (){
   /// \todo Tato funkce by měla vrátit ukazatel na začátek barevného bufferu.<br>
+    finish();
+    resolveClear(zmazatFarbu);
   return  &myframe.color[0];
 }
 
@@ -579,6 +1388,10 @@ uint8_t* GPU::getFramebufferColor  (){
  */
 float* GPU::getFramebufferDepth    (){
   /// \todo tato funkce by mla vrátit ukazatel na začátek hloubkového bufferu.<br>
+    // hlbka sa moze zmenit mimo GPU, hrube hlbky sa pred dalsim kreslenim prepocitaju
+    finish();
+    resolveClear(zmazatHlbku);
+    myframe.hiz_platny = false;
   return  &myframe.hlbka[0];
 }
 
@@ -602,6 +1415,207 @@ uint32_t GPU::getFramebufferHeight(){
   return  myframe.h;
 }
 
+/**
+ * @brief This function sets number of framebuffers used for presentation.
+ *
+ * Rendering goes to one framebuffer, the others hold presented frames, so a consumer
+ * can read frame N while frame N+1 is rendered. Pending submissions are finished and
+ * presented frames are dropped.
+ *
+ * @param count number of framebuffers, 1 = single buffering, 2 = double buffering, ...
+ */
+void GPU::setFramebufferCount    (uint32_t count){
+    finish();
+    prezentovane.assign(std::max(count, 1u) - 1, frame());
+    posledny_prezent = -1;
+}
+
+/**
+ * @brief This function returns number of framebuffers used for presentation.
+ *
+ * @return number of framebuffers including the one that is rendered to
+ */
+uint32_t GPU::getFramebufferCount    (){
+    return (uint32_t)prezentovane.size() + 1;
+}
+
+/**
+ * @brief This function presents rendered frame.
+ *
+ * Rendered framebuffer is swapped with the oldest presented one without copying,
+ * then it can be read by getPresentedColor and getPresentedDepth.
+ * A presented frame stays valid until getFramebufferCount() - 1 further presents.
+ * Content of the new render target is undefined, it should be cleared.
+ * If asynchronous submissions are pending, present is queued after them.
+ *
+ * @return fence that is signaled when the frame is presented
+ */
+FenceID GPU::present             (){
+    bool caka;
+    {
+        std::lock_guard<std::mutex> lock(fronta_zamok);
+        caka = dokoncene != odoslane;
+    }
+    if (caka)
+    {
+        CommandBuffer prikazy;
+        prikazy.present();
+        return submitAsync(prikazy);
+    }
+    presentFrame();
+    std::lock_guard<std::mutex> lock(fronta_zamok);
+    return odoslane;
+}
+
+/**
+ * @brief This function returns color buffer of the last presented frame.
+ *
+ * @return pointer to color buffer, nullptr if no frame was presented
+ */
+uint8_t* GPU::getPresentedColor  (){
+    frame* f = presentedFrame();
+    return f ? f->color.data() : nullptr;
+}
+
+/**
+ * @brief This function returns depth buffer of the last presented frame.
+ *
+ * @return pointer to depth buffer, nullptr if no frame was presented
+ */
+float* GPU::getPresentedDepth    (){
+    frame* f = presentedFrame();
+    return f ? f->hlbka.data() : nullptr;
+}
+
+/**
+ * @brief This function returns width of the last presented frame.
+ *
+ * @return width of presented frame, 0 if no frame was presented
+ */
+uint32_t GPU::getPresentedWidth  (){
+    frame* f = presentedFrame();
+    return f ? f->w : 0;
+}
+
+/**
+ * @brief This function returns height of the last presented frame.
+ *
+ * @return height of presented frame, 0 if no frame was presented
+ */
+uint32_t GPU::getPresentedHeight (){
+    frame* f = presentedFrame();
+    return f ? f->h : 0;
+}
+
+/**
+ * @brief This function returns the last presented frame.
+ *
+ * @return presented frame, myframe for single buffering, nullptr if no frame was presented
+ */
+GPU::frame* GPU::presentedFrame  (){
+    std::lock_guard<std::mutex> lock(fronta_zamok);
+    if (posledny_prezent < 0)
+    {
+        return nullptr;
+    }
+    return prezentovane.empty() ? &myframe : &prezentovane[posledny_prezent];
+}
+
+/**
+ * @brief This function swaps rendered framebuffer with the oldest presented one.
+ */
+void GPU::presentFrame           (){
+    // odlozene mazanie sa musi dokoncit, prezentovany snimok sa cita mimo GPU
+    resolveClear(zmazatFarbu | zmazatHlbku);
+    int i = 0;
+    {
+        // vymena len prehodi vektory, pod zamkom aby ju citatel nevidel v polovici
+        std::lock_guard<std::mutex> lock(fronta_zamok);
+        if (!prezentovane.empty())
+        {
+            i = (posledny_prezent + 1) % (int)prezentovane.size();
+            std::swap(myframe, prezentovane[i]);
+        }
+        posledny_prezent = i;
+    }
+    if (prezentovane.empty())
+    {
+        return;
+    }
+    frame const& predosly = prezentovane[i];
+    if (myframe.w != predosly.w || myframe.h != predosly.h)
+    {
+        myframe.w = predosly.w;
+        myframe.h = predosly.h;
+        myframe.color.resize(4 * myframe.w * myframe.h);
+        myframe.hlbka.resize(myframe.w * myframe.h);
+        resizeHiZ();
+    }
+}
+
+/**
+ * @brief This function resizes coarse depth buffer and fast clear tags to the size of framebuffer.
+ */
+void GPU::resizeHiZ(){
+    int tiles = ((myframe.w + tileSize - 1) / tileSize) * ((myframe.h + tileSize - 1) / tileSize);
+    myframe.zmazat.assign(tiles, 0);
+    myframe.hiz_w = (myframe.w + hizSize - 1) / hizSize;
+    myframe.hiz_h = (myframe.h + hizSize - 1) / hizSize;
+    myframe.hiz_min.resize(myframe.hiz_w * myframe.hiz_h);
+    myframe.hiz_max.resize(myframe.hiz_w * myframe.hiz_h);
+    myframe.hiz_platny = false;
+}
+
+/**
+ * @brief This function recomputes whole coarse depth buffer from the depth buffer.
+ */
+void GPU::rebuildHiZ(){
+    for (int y = 0; y < myframe.h; y += tileSize)
+    {
+        for (int x = 0; x < myframe.w; x += tileSize)
+        {
+            updateHiZ(x, y, ~(uint64_t)0);
+        }
+    }
+    myframe.hiz_platny = true;
+}
+
+/**
+ * @brief This function recomputes selected blocks of coarse depth buffer inside of one tile.
+ *
+ * @param x0 first column of the tile
+ * @param y0 first row of the tile
+ * @param bloky mask of blocks of the tile, bit = by * 8 + bx
+ */
+void GPU::updateHiZ(int x0,int y0,uint64_t bloky){
+    for (int b = 0; b < 64; b++)
+    {
+        if (!(bloky & ((uint64_t)1 << b)))
+        {
+            continue;
+        }
+        int bx = x0 + (b % 8) * hizSize;
+        int by = y0 + (b / 8) * hizSize;
+        if (bx >= myframe.w || by >= myframe.h)
+        {
+            continue;
+        }
+        float z_min = myframe.hlbka[by * myframe.w + bx];
+        float z_max = z_min;
+        for (int h = by; h < std::min(by + hizSize, myframe.h); h++)
+        {
+            for (int w = bx; w < std::min(bx + hizSize, myframe.w); w++)
+            {
+                z_min = std::min(z_min, myframe.hlbka[h * myframe.w + w]);
+                z_max = std::max(z_max, myframe.hlbka[h * myframe.w + w]);
+            }
+        }
+        int idx = (by / hizSize) * myframe.hiz_w + bx / hizSize;
+        myframe.hiz_min[idx] = z_min;
+        myframe.hiz_max[idx] = z_max;
+    }
+}
+
 /// @}
 
 /** \addtogroup draw_tasks 05. Implementace vykreslovacích funkcí
@@ -623,117 +1637,585 @@ void            GPU::clear                 (float r,float g,float b,float a){
   /// (0,0,0) - černá barva, (1,1,1) - bílá barva.<br>
   /// Hloubkový buffer nastaví na takovou hodnotu, která umožní rasterizaci trojúhelníka, který leží v rámci pohledového tělesa.<br>
   /// Hloubka by měla být tedy větší než maximální hloubka v NDC (normalized device coordinates).<br>
-    int max =  myframe.h * myframe.w;
-    //std::cout << max << "    " << myframe.hlbka.size() << std::endl;
-    for (int i = 0; i < max; i++)
-    {//std::cout << i << std::endl;
-        if (r > 1)
-            myframe.color[(i * 4)] = 255;
-        else
-            myframe.color[(i * 4)] = (int)(r * 255);
-        if (g > 1)
-            myframe.color[(i * 4 + 1)] = 255;
-        else
-            myframe.color[(i * 4 + 1)] = (int)(g * 255);
-        if (b > 1)
-            myframe.color[(i * 4 + 2)] = 255;
-        else
-            myframe.color[(i * 4 + 2)] = (int)(b*255);
-        if (a > 1)
-            myframe.color[(i * 4 + 3)] = 255;
-        else
-            myframe.color[(i * 4 + 3)] = (int) (a*255);
-        myframe.hlbka[i] = 1.1f;
-    }
+    finish();
+    clearColor(r, g, b, a);
+    clearDepth(1.1f);
 }
 
-
-
-void            GPU::drawTriangles         (uint32_t  nofVertices){
-  /// \todo Tato funkce vykreslí trojúhelníky podle daného nastavení.<br>
-  /// Vrcholy se budou vybírat podle nastavení z aktivního vertex pulleru (pomocí bindVertexPuller).<br>
-  /// Vertex shader a fragment shader se zvolí podle aktivního shader programu (pomocí useProgram).<br>
-  /// Parametr "nofVertices" obsahuje počet vrcholů, který by se měl vykreslit (3 pro jeden trojúhelník).<br>
-
-
-// zdroj informacii pre implementaciu rasterizacie https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation
-
-
-    InVertex vrcholy;
-    OutVertex vrcholy_out;
-	vrcholy_out.gl_Position = glm::vec4(0, 0, 0, 0);
-    std::vector<trojuhol> trojuholnik;
-    trojuhol troj;
-    
-    for (uint32_t j = 0; j < nofVertices; j++)
+/**
+ * @brief This function fills n 32 bit values with the same value.
+ *
+ * @param ciel destination, it does not have to be aligned
+ * @param hodnota value
+ * @param n number of values
+ */
+static void vypln32(void* ciel, uint32_t hodnota, size_t n){
+    char* p = (char*)ciel;
+    size_t i = 0;
+#if GPU_X86
+    __m128i v = _mm_set1_epi32((int)hodnota);
+    for (; i + 8 <= n; i += 8)
     {
-        
-        if (vertex_list[aktiv_vertex]->ind)
-        {
-            int type = (int)vertex_list[aktiv_vertex]->index.type;
-            ten_type = type;
-            if (type == 1)
-            {
-                //uint8_t poradie;
-            getBufferData(vertex_list[aktiv_vertex]->index.buffer, sizeof(uint8_t) * j,sizeof(uint8_t), &poradie1);
-            vrcholy.gl_VertexID = (uint32_t)(poradie1);
-            }
-            else if (type == 2)
-            {
-                //uint16_t poradie;
-                getBufferData(vertex_list[aktiv_vertex]->index.buffer,sizeof(uint16_t) * j,sizeof(uint16_t), &poradie2);
-                vrcholy.gl_VertexID = (uint32_t)(poradie2);
-            }
-            else
-            {
-               // uint32_t poradie;
+        _mm_storeu_si128((__m128i*)(p + 4 * i), v);
+        _mm_storeu_si128((__m128i*)(p + 4 * i + 16), v);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        memcpy(p + 4 * i, &hodnota, 4);
+    }
+}
 
-                getBufferData(vertex_list[aktiv_vertex]->index.buffer,sizeof(uint32_t) * j,sizeof(uint32_t), &poradie3);
-                vrcholy.gl_VertexID = poradie3;
-            }
-        }
+/**
+ * @brief This function clears color buffer.
+ *
+ * The color is converted to RGBA8 once and the buffer is filled with whole pixels.
+ * With fast clear, tiles are only tagged and cleared when they are drawn to or read.
+ *
+ * @param r red channel
+ * @param g green channel
+ * @param b blue channel
+ * @param a alpha channel
+ */
+void            GPU::clearColor            (float r,float g,float b,float a){
+    finish();
+    float kanaly[4] = { r, g, b, a };
+    uint8_t pixel[4];
+    for (int i = 0; i < 4; i++)
+    {
+        if (kanaly[i] > 1)
+            pixel[i] = 255;
         else
+            pixel[i] = (int)(kanaly[i] * 255);
+    }
+    memcpy(&myframe.zmazat_farba, pixel, 4);
+    if (fast_clear)
+    {
+        for (int i = 0; i < myframe.zmazat.size(); i++)
         {
-           vrcholy.gl_VertexID  = j;
+            myframe.zmazat[i] |= zmazatFarbu;
         }
-        
-        for (uint32_t i = 0; i < maxAttributes; i++)
-        {
-            hlava hlava = vertex_list[aktiv_vertex]->hlavy[i];
-            if (hlava.enable)
-            {
+        return;
+    }
+    for (int i = 0; i < myframe.zmazat.size(); i++)
+    {
+        myframe.zmazat[i] &= ~zmazatFarbu;
+    }
+    vypln32(myframe.color.data(), myframe.zmazat_farba, myframe.hlbka.size());
+}
 
-                void* ciel = NULL;
-                switch ((int)hlava.type)
-                {
-                case 1: ciel = &vrcholy.attributes[i].v1; break;
-                case 2: ciel = &vrcholy.attributes[i].v2; break;
-                case 3: ciel = &vrcholy.attributes[i].v3; break;
-                case 4: ciel = &vrcholy.attributes[i].v4; break;
-                }
-                getBufferData(hlava.buffer, hlava.offset + hlava.stride * vrcholy.gl_VertexID, (int)hlava.type * sizeof(float), ciel);
-            }
-        }
-        program_list[aktiv_prog]->vs(vrcholy_out, vrcholy, program_list[aktiv_prog]->premenne);
-        troj.body[j % 3] = vrcholy_out;
-       
-        //trojuholnik[j / 3].body[j % 3] = vrcholy_out[j];
-        if (-vrcholy_out.gl_Position.w > vrcholy_out.gl_Position.z)
+/**
+ * @brief This function clears depth buffer.
+ *
+ * Coarse depth buffer is set directly, so it does not have to be rebuilt.
+ * With fast clear, tiles are only tagged and cleared when they are drawn to or read.
+ *
+ * @param depth new depth, it should be bigger than maximal depth in NDC (1.1 is used by clear)
+ */
+void            GPU::clearDepth            (float depth){
+    finish();
+    myframe.zmazat_hlbka = depth;
+    std::fill(myframe.hiz_min.begin(), myframe.hiz_min.end(), depth);
+    std::fill(myframe.hiz_max.begin(), myframe.hiz_max.end(), depth);
+    myframe.hiz_platny = true;
+    if (fast_clear)
+    {
+        for (int i = 0; i < myframe.zmazat.size(); i++)
         {
-            clip_bod.push_back(j % 3);
+            myframe.zmazat[i] |= zmazatHlbku;
         }
-    
-        
+        return;
+    }
+    for (int i = 0; i < myframe.zmazat.size(); i++)
+    {
+        myframe.zmazat[i] &= ~zmazatHlbku;
+    }
+    uint32_t bity;
+    memcpy(&bity, &depth, 4);
+    vypln32(myframe.hlbka.data(), bity, myframe.hlbka.size());
+}
 
+/**
+ * @brief This function enables or disables fast clear.
+ *
+ * With fast clear, clearColor and clearDepth only tag tiles of the framebuffer.
+ * A tile is filled with the clear value by the rasterization thread before
+ * the first triangle is drawn to it, tiles that are not drawn to are filled
+ * when the framebuffer is read by getFramebufferColor or getFramebufferDepth.
+ * It is disabled by default.
+ *
+ * @param enable true enables fast clear
+ */
+void            GPU::setFastClear          (bool enable){
+    finish();
+    if (!enable)
+    {
+        resolveClear(zmazatFarbu | zmazatHlbku);
+    }
+    fast_clear = enable;
+}
+
+/**
+ * @brief This function physically clears deferred buffers of one tile.
+ *
+ * @param tile index of tile
+ * @param co buffers to clear, zmazatFarbu and/or zmazatHlbku
+ */
+void            GPU::resolveTileClear      (uint32_t tile,uint8_t co){
+    co &= myframe.zmazat[tile];
+    if (!co)
+    {
+        return;
+    }
+    int tx = (myframe.w + tileSize - 1) / tileSize;
+    int x0 = (tile % tx) * tileSize;
+    int y0 = (tile / tx) * tileSize;
+    int x1 = std::min(x0 + tileSize, myframe.w);
+    int y1 = std::min(y0 + tileSize, myframe.h);
+    uint32_t bity;
+    memcpy(&bity, &myframe.zmazat_hlbka, 4);
+    for (int h = y0; h < y1; h++)
+    {
+        if (co & zmazatFarbu)
+        {
+            vypln32(&myframe.color[4 * (h * myframe.w + x0)], myframe.zmazat_farba, x1 - x0);
+        }
+        if (co & zmazatHlbku)
+        {
+            vypln32(&myframe.hlbka[h * myframe.w + x0], bity, x1 - x0);
+        }
+    }
+    myframe.zmazat[tile] &= ~co;
+}
+
+/**
+ * @brief This function physically clears deferred buffers of all tiles.
+ *
+ * @param co buffers to clear, zmazatFarbu and/or zmazatHlbku
+ */
+void            GPU::resolveClear          (uint8_t co){
+    for (uint32_t i = 0; i < myframe.zmazat.size(); i++)
+    {
+        resolveTileClear(i, co);
+    }
+}
+
+
+/**
+ * @brief This function prepares vertex pulling of the active vertex puller for one draw.
+ *
+ * Enabled heads of the vertex puller are compiled into a fetch plan, which is kept in the vertex puller
+ * until its heads change. Base pointers of buffers are resolved once per draw, because buffers
+ * can be reallocated between draws.
+ */
+void            GPU::prepareVertexFetch    (){
+    tabulka* t = vertex_list[aktiv_vertex];
+    if (!t->plan_platny)
+    {
+        t->plan_pocet = 0;
+        for (uint32_t i = 0; i < maxAttributes; i++)
+        {
+            if (t->hlavy[i].enable)
+            {
+                citanie& c = t->plan[t->plan_pocet++];
+                c.atribut = i;
+                c.velkost = (uint32_t)t->hlavy[i].type * sizeof(float);
+                c.stride = t->hlavy[i].stride;
+                c.zaciatok = NULL;
+            }
+        }
+        t->plan_platny = true;
+    }
+    for (uint32_t i = 0; i < t->plan_pocet; i++)
+    {
+        hlava const& h = t->hlavy[t->plan[i].atribut];
+        t->plan[i].zaciatok = static_cast<char const*>(buffer_list[h.buffer]) + h.offset;
+    }
+    index_data = NULL;
+    if (t->ind)
+    {
+        if (index_narrowing && !t->uzke_platne)
+        {
+            narrowIndices(*t);
+        }
+        index_data = static_cast<char const*>(buffer_list[t->index.buffer]);
+        index_type = t->index.type;
+        if (index_narrowing && !t->uzke_indexy.empty())
+        {
+            index_data = (char const*)t->uzke_indexy.data();
+            index_type = t->uzky_typ;
+        }
+    }
+}
+
+/**
+ * @brief This function converts indices of one batch of the active vertex puller to uint32_t.
+ *
+ * Type of index is resolved once per batch, the loops are simple enough to be vectorized.
+ *
+ * @param zaciatok number of the first vertex of the batch in the draw
+ * @param koniec number of the vertex after the batch
+ */
+void            GPU::readIndices           (uint32_t zaciatok,uint32_t koniec){
+    uint32_t pocet = koniec - zaciatok;
+    indexy.resize(pocet);
+    uint32_t* ciel = indexy.data();
+    switch (index_type)
+    {
+    case IndexType::UINT8:
+    {
+        uint8_t const* zdroj = (uint8_t const*)index_data + zaciatok;
+        for (uint32_t i = 0; i < pocet; i++)
+        {
+            ciel[i] = zdroj[i];
+        }
+        break;
+    }
+    case IndexType::UINT16:
+    {
+        // buffer moze byt zarovnany len na bajt
+        char const* zdroj = index_data + sizeof(uint16_t) * zaciatok;
+        for (uint32_t i = 0; i < pocet; i++)
+        {
+            uint16_t idx;
+            memcpy(&idx, zdroj + sizeof(uint16_t) * i, sizeof(uint16_t));
+            ciel[i] = idx;
+        }
+        break;
+    }
+    default:
+        memcpy(ciel, index_data + sizeof(uint32_t) * zaciatok, sizeof(uint32_t) * pocet);
+        break;
+    }
+}
+
+/**
+ * @brief This function makes narrower copy of index buffer of vertex puller.
+ *
+ * If all indices fit into uint8_t or uint16_t and the buffer uses wider type,
+ * the copy halves or quarters bandwidth of index reads. Otherwise no copy is made.
+ *
+ * @param t vertex puller with indexing
+ */
+void            GPU::narrowIndices         (tabulka& t){
+    t.uzke_platne = true;
+    buf_bloky[t.index.buffer].zuzeny = true;
+    t.uzke_indexy.clear();
+    uint32_t sirka = (uint32_t)t.index.type;
+    if (sirka == 1)
+    {
+        return;
+    }
+    index_data = static_cast<char const*>(buffer_list[t.index.buffer]);
+    index_type = t.index.type;
+    uint32_t pocet = (uint32_t)(buf_bloky[t.index.buffer].velkost / sirka);
+    readIndices(0, pocet);
+    uint32_t maximum = 0;
+    for (uint32_t i = 0; i < pocet; i++)
+    {
+        maximum = std::max(maximum, indexy[i]);
+    }
+    uint32_t nova_sirka = maximum <= 0xff ? 1 : maximum <= 0xffff ? 2 : 4;
+    if (nova_sirka >= sirka)
+    {
+        return;
+    }
+    t.uzke_indexy.resize((size_t)pocet * nova_sirka);
+    if (nova_sirka == 1)
+    {
+        for (uint32_t i = 0; i < pocet; i++)
+        {
+            t.uzke_indexy[i] = (uint8_t)indexy[i];
+        }
+        t.uzky_typ = IndexType::UINT8;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < pocet; i++)
+        {
+            uint16_t idx = (uint16_t)indexy[i];
+            memcpy(&t.uzke_indexy[2 * (size_t)i], &idx, sizeof(uint16_t));
+        }
+        t.uzky_typ = IndexType::UINT16;
+    }
+}
+
+/**
+ * @brief This function drops narrowed copies of buffer after its content was changed.
+ *
+ * Vertex pullers are walked only if some of them narrowed the buffer since its last change.
+ *
+ * @param buffer changed buffer
+ */
+void            GPU::invalidateIndexCopies (BufferID buffer){
+    if (!buf_bloky[buffer].zuzeny)
+    {
+        return;
+    }
+    buf_bloky[buffer].zuzeny = false;
+    for (uint32_t i = 0; i < vertex_list.size(); i++)
+    {
+        tabulka* t = vertex_list[i];
+        if (t != NULL && t->ind && t->index.buffer == buffer)
+        {
+            t->uzke_platne = false;
+            t->uzke_indexy.clear();
+        }
+    }
+}
+
+/**
+ * @brief This function reads attributes of one vertex according to the fetch plan.
+ *
+ * @param vrchol input vertex, its gl_VertexID selects the vertex
+ */
+void            GPU::fetchVertex           (InVertex& vrchol){
+    tabulka const* t = vertex_list[aktiv_vertex];
+    for (uint32_t i = 0; i < t->plan_pocet; i++)
+    {
+        citanie const& c = t->plan[i];
+        char const* zdroj = c.zaciatok + c.stride * vrchol.gl_VertexID;
+        void* ciel = &vrchol.attributes[c.atribut];
+        // konstantna velkost, memcpy sa prelozi na obycajne citanie
+        switch (c.velkost)
+        {
+        case 4: memcpy(ciel, zdroj, 4); break;
+        case 8: memcpy(ciel, zdroj, 8); break;
+        case 12: memcpy(ciel, zdroj, 12); break;
+        case 16: memcpy(ciel, zdroj, 16); break;
+        }
+    }
+}
+
+void            GPU::drawTriangles         (uint32_t  nofVertices){
+  /// \todo Tato funkce vykreslí trojúhelníky podle daného nastavení.<br>
+  /// Vrcholy se budou vybírat podle nastavení z aktivního vertex pulleru (pomocí bindVertexPuller).<br>
+  /// Vertex shader a fragment shader se zvolí podle aktivního shader programu (pomocí useProgram).<br>
+  /// Parametr "nofVertices" obsahuje počet vrcholů, který by se měl vykreslit (3 pro jeden trojúhelník).<br>
+    finish();
+
+
+// zdroj informacii pre implementaciu rasterizacie https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation
+
+
+    uint32_t prvy = 0;
+    drawRanges(&prvy, &nofVertices, 1, 1);
+}
+
+/**
+ * @brief This function draws nofInstances copies of triangles.
+ *
+ * Vertex pulling, setup and worker threads are prepared once for all instances
+ * and triangles of different instances share batches.
+ * Index of instance is written (as float) to the uniform selected by setInstanceUniform
+ * before vertices of the instance are processed, it is valid in vertex shader only.
+ *
+ * @param nofVertices number of vertices of one instance
+ * @param nofInstances number of instances
+ */
+void            GPU::drawTrianglesInstanced(uint32_t nofVertices,uint32_t nofInstances){
+    finish();
+    uint32_t prvy = 0;
+    drawRanges(&prvy, &nofVertices, 1, nofInstances);
+}
+
+/**
+ * @brief This function draws several ranges of vertices of the bound vertex puller by one call.
+ *
+ * It is the same as calling drawTriangles for every range, but setup is done once
+ * and small ranges share batches. Vertex i of range d has gl_VertexID first[d] + i
+ * (or the index at position first[d] + i for indexed drawing).
+ *
+ * @param first first vertex of every range
+ * @param count number of vertices of every range
+ * @param drawCount number of ranges
+ */
+void            GPU::multiDraw             (uint32_t const* first,uint32_t const* count,uint32_t drawCount){
+    finish();
+    drawRanges(first, count, drawCount, 1);
+}
+
+/**
+ * @brief This function selects uniform that receives index of instance in drawTrianglesInstanced.
+ *
+ * InVertex has no instance index, so the index is passed to vertex shader in uniforms.
+ *
+ * @param prg shader program
+ * @param uniformId index of uniform, its v1 is set to index of instance, maxUniforms disables it
+ */
+void            GPU::setInstanceUniform    (ProgramID prg,uint32_t uniformId){
+    finish();
+    program_list[prg]->instance_uniform = uniformId;
+}
+
+/**
+ * @brief This function draws ranges of vertices, all of them nofInstances times.
+ *
+ * Triangles go through the pipeline in batches of velkost_davky triangles,
+ * a batch can contain triangles of several ranges and instances.
+ *
+ * @param first first vertex of every range
+ * @param count number of vertices of every range
+ * @param drawCount number of ranges
+ * @param nofInstances number of instances
+ */
+void            GPU::drawRanges            (uint32_t const* first,uint32_t const* count,uint32_t drawCount,uint32_t nofInstances){
+    setupFrustumPlanes();
+    prepareVertexFetch();
+    prepareVaryings();
+    if (!myframe.hiz_platny)
+    {
+        rebuildHiZ();
+    }
+    program* prog = program_list[aktiv_prog];
+    applyUniformBlocks(prog);
+    if (prog->preambula)
+    {
+        prog->preambula(prog->premenne);
+    }
+
+    // davky trojuholnikov prechadzaju celou pipeline, pamat je obmedzena velkostou davky
+    uint64_t limit = (uint64_t)velkost_davky * 3;
+    uint64_t v_davke = 0;
+    beginBatch();
+    for (uint32_t instancia = 0; instancia < nofInstances; instancia++)
+    {
+        if (prog->instance_uniform < maxUniforms)
+        {
+            prog->premenne.uniform[prog->instance_uniform].v1 = (float)instancia;
+            // vystupy vertex shaderu v cache patria predchadzajucej instancii
+            std::fill(cache_tag.begin(), cache_tag.end(), (uint64_t)prazdny_tag);
+        }
+        for (uint32_t d = 0; d < drawCount; d++)
+        {
+            uint32_t zaciatok = first[d];
+            uint32_t koniec = zaciatok + count[d] - count[d] % 3;
+            while (zaciatok < koniec)
+            {
+                uint32_t krok = koniec - zaciatok;
+                if (limit > 0)
+                {
+                    krok = (uint32_t)std::min<uint64_t>(krok, limit - v_davke);
+                }
+                pullVertices(zaciatok, zaciatok + krok);
+                zaciatok += krok;
+                v_davke += krok;
+                if (limit > 0 && v_davke == limit)
+                {
+                    finishBatch();
+                    beginBatch();
+                    v_davke = 0;
+                }
+            }
+        }
+    }
+    if (v_davke > 0)
+    {
+        finishBatch();
+    }
+#if GPU_STATISTICS
+    // rasterizeTile meria celu dlazdicu, FS a ROP sa z nej odcitaju
+    for (int i = 0; i < pamat_vlakien.size(); i++)
+    {
+        GPUStatistics& s = pamat_vlakien[i].statistiky;
+        statistiky.fragmentsGenerated += s.fragmentsGenerated;
+        statistiky.fragmentsDepthKilled += s.fragmentsDepthKilled;
+        statistiky.fragmentsWritten += s.fragmentsWritten;
+        statistiky.msRaster += s.msRaster - s.msFS - s.msROP;
+        statistiky.msFS += s.msFS;
+        statistiky.msROP += s.msROP;
+        s = GPUStatistics();
+    }
+#endif
+}
+
+/**
+ * @brief This function starts new batch of triangles, data of the previous batch are dropped.
+ */
+void            GPU::beginBatch            (){
+    trojuholnik.clear();
+    vrch_pozicie.clear();
+    vrch_premenne.clear();
+    // cache odkazuje do ulozenych vrcholov davky
+    std::fill(cache_tag.begin(), cache_tag.end(), (uint64_t)prazdny_tag);
+}
+
+/**
+ * @brief This function processes vertices by vertex shader and assembles and clips their triangles.
+ *
+ * Triangles are added to the current batch.
+ *
+ * @param zaciatok first vertex
+ * @param koniec vertex after the last vertex, koniec - zaciatok has to be a multiple of 3
+ */
+void            GPU::pullVertices          (uint32_t zaciatok,uint32_t koniec){
+    InVertex vrcholy;
+    OutVertex vrcholy_out;
+	vrcholy_out.gl_Position = glm::vec4(0, 0, 0, 0);
+    trojuhol troj;
+
+    // cache ma zmysel len pri indexovanom kresleni
+    bool pouzi_cache = vertex_list[aktiv_vertex]->ind && cache_tag.size() > 0;
+    if (index_data != NULL)
+    {
+        readIndices(zaciatok, koniec);
+    }
+    
+    for (uint32_t j = zaciatok; j < koniec; j++)
+    {
+        uint32_t roh = (j - zaciatok) % 3;
+        GPU_STAT(stat_cas cas = statTeraz());
+        if (index_data != NULL)
+        {
+            vrcholy.gl_VertexID = indexy[j - zaciatok];
+        }
+        else
+        {
+           vrcholy.gl_VertexID  = j;
+        }
+        
+        // vo vyrovnavacej pamati su indexy spracovanych vrcholov podla gl_VertexID
+        uint32_t slot = vrcholy.gl_VertexID & (uint32_t)(cache_tag.size() - 1);
+        bool zasah = pouzi_cache && cache_tag[slot] == vrcholy.gl_VertexID;
+        uint32_t vrchol;
+        if (zasah)
+        {
+            vrchol = cache_vrcholy[slot];
+            cache_hits++;
+            GPU_STAT(statistiky.msPull += statMs(cas));
+        }
+        else
+        {
+            fetchVertex(vrcholy);
+            GPU_STAT(statistiky.msPull += statMs(cas));
+            program_list[aktiv_prog]->vs(vrcholy_out, vrcholy, program_list[aktiv_prog]->premenne);
+            GPU_STAT(statistiky.msVS += statMs(cas); statistiky.verticesShaded++);
+            vrchol = storeVertex(vrcholy_out);
+            if (pouzi_cache)
+            {
+                cache_tag[slot] = vrcholy.gl_VertexID;
+                cache_vrcholy[slot] = vrchol;
+                cache_misses++;
+            }
+        }
+        troj.vrchol[roh] = vrchol;
+       
+        if (-vrch_pozicie[vrchol].w > vrch_pozicie[vrchol].z)
+        {
+            clip_bod.push_back(roh);
+        }
     
-        if (j % 3 == 2)
+        if (roh == 2)
         {
-            if (clip_bod.size() == 3)
+            GPU_STAT(statistiky.trianglesIn++);
+            if (clip_bod.size() == 3 || isOutsideFrustum(troj))
             {
+                GPU_STAT(statistiky.trianglesCulled++);
                 clip_bod.clear();
             }
             else if (clip_bod.size() == 1)
             {
+                GPU_STAT(statistiky.trianglesClipped++);
                 int bod1, bod2;
                 switch (clip_bod[0])
                 {
@@ -741,299 +2223,1335 @@ void            GPU::drawTriangles         (uint32_t  nofVertices){
                 case 1:bod1 = 0; bod2 = 2; break;
                 case 2:bod1 = 0; bod2 = 1; break;
                 }
-                float citatel = -troj.body[clip_bod[0]].gl_Position.w - troj.body[clip_bod[0]].gl_Position.z;
-                float t1 = (citatel) / (troj.body[bod1].gl_Position.w - troj.body[clip_bod[0]].gl_Position.w + troj.body[bod1].gl_Position.z - troj.body[clip_bod[0]].gl_Position.z);
-                float t2 = (citatel) / (troj.body[bod2].gl_Position.w - troj.body[clip_bod[0]].gl_Position.w + troj.body[bod2].gl_Position.z - troj.body[clip_bod[0]].gl_Position.z);
-                OutVertex vrchol1;
+                glm::vec4 P = vrch_pozicie[troj.vrchol[clip_bod[0]]];
+                glm::vec4 P1 = vrch_pozicie[troj.vrchol[bod1]];
+                glm::vec4 P2 = vrch_pozicie[troj.vrchol[bod2]];
+                float citatel = -P.w - P.z;
+                float t1 = (citatel) / (P1.w - P.w + P1.z - P.z);
+                float t2 = (citatel) / (P2.w - P.w + P2.z - P.z);
                 trojuhol trojuholnik2;
-                trojuholnik2.body[clip_bod[0]] = troj.body[bod1];
-                trojuholnik2.body[bod1].gl_Position = troj.body[clip_bod[0]].gl_Position + t1 * (troj.body[bod1].gl_Position - troj.body[clip_bod[0]].gl_Position);
-                trojuholnik2.body[bod2].gl_Position = troj.body[clip_bod[0]].gl_Position + t2 * (troj.body[bod2].gl_Position - troj.body[clip_bod[0]].gl_Position);
-                for (uint32_t i = 0; i < maxAttributes; i++)
-                {
-                    
-                    trojuholnik2.body[bod1].attributes[i].v1 = troj.body[clip_bod[0]].attributes[i].v1 + t1 * (troj.body[bod1].attributes[i].v1 - troj.body[clip_bod[0]].attributes[i].v1);
-                    trojuholnik2.body[bod1].attributes[i].v2 = troj.body[clip_bod[0]].attributes[i].v2 + t1 * (troj.body[bod1].attributes[i].v2 - troj.body[clip_bod[0]].attributes[i].v2);
-                    trojuholnik2.body[bod1].attributes[i].v3 = troj.body[clip_bod[0]].attributes[i].v3 + t1 * (troj.body[bod1].attributes[i].v3 - troj.body[clip_bod[0]].attributes[i].v3);
-                    trojuholnik2.body[bod1].attributes[i].v4 = troj.body[clip_bod[0]].attributes[i].v4 + t1 * (troj.body[bod1].attributes[i].v4 - troj.body[clip_bod[0]].attributes[i].v4);
-                    trojuholnik2.body[bod2].attributes[i].v1 = troj.body[clip_bod[0]].attributes[i].v1 + t2 * (troj.body[bod2].attributes[i].v1 - troj.body[clip_bod[0]].attributes[i].v1);
-                    trojuholnik2.body[bod2].attributes[i].v2 = troj.body[clip_bod[0]].attributes[i].v2 + t2 * (troj.body[bod2].attributes[i].v2 - troj.body[clip_bod[0]].attributes[i].v2);
-                    trojuholnik2.body[bod2].attributes[i].v3 = troj.body[clip_bod[0]].attributes[i].v3 + t2 * (troj.body[bod2].attributes[i].v3 - troj.body[clip_bod[0]].attributes[i].v3);
-                    trojuholnik2.body[bod2].attributes[i].v4 = troj.body[clip_bod[0]].attributes[i].v4 + t2 * (troj.body[bod2].attributes[i].v4 - troj.body[clip_bod[0]].attributes[i].v4);
-                }
+                trojuholnik2.vrchol[clip_bod[0]] = troj.vrchol[bod1];
+                trojuholnik2.vrchol[bod1] = lerpVertex(troj.vrchol[clip_bod[0]], troj.vrchol[bod1], t1);
+                trojuholnik2.vrchol[bod2] = lerpVertex(troj.vrchol[clip_bod[0]], troj.vrchol[bod2], t2);
 
-                trojuholnik.push_back(trojuholnik2);
-                troj.body[clip_bod[0]] = trojuholnik2.body[bod2];
-                trojuholnik.push_back(troj);
+                emitTriangle(trojuholnik2);
+                troj.vrchol[clip_bod[0]] = trojuholnik2.vrchol[bod2];
+                emitTriangle(troj);
                 clip_bod.clear();
             }
             else if (clip_bod.size() == 2)
             {
+                GPU_STAT(statistiky.trianglesClipped++);
                 int bod = 3 - clip_bod[0] - clip_bod[1];
-                float citatel = -troj.body[bod].gl_Position.w - troj.body[bod].gl_Position.z;
-                float t1 = (citatel) / (troj.body[clip_bod[0]].gl_Position.w -troj.body[bod].gl_Position.w  + troj.body[clip_bod[0]].gl_Position.z - troj.body[bod].gl_Position.z);
-                float t2 = (citatel) / (troj.body[clip_bod[1]].gl_Position.w - troj.body[bod].gl_Position.w + troj.body[clip_bod[1]].gl_Position.z - troj.body[bod].gl_Position.z);
-                troj.body[clip_bod[0]].gl_Position = troj.body[bod].gl_Position + t1 * (troj.body[clip_bod[0]].gl_Position - troj.body[bod].gl_Position);
-                troj.body[clip_bod[1]].gl_Position = troj.body[bod].gl_Position + t2 * (troj.body[clip_bod[1]].gl_Position - troj.body[bod].gl_Position);
-                for (uint32_t i = 0; i < maxAttributes; i++)
-                {
-
-                    troj.body[clip_bod[0]].attributes[i].v1 = troj.body[bod].attributes[i].v1 + t1 * (troj.body[clip_bod[0]].attributes[i].v1 - troj.body[bod].attributes[i].v1);
-                    troj.body[clip_bod[0]].attributes[i].v2 = troj.body[bod].attributes[i].v2 + t1 * (troj.body[clip_bod[0]].attributes[i].v2 - troj.body[bod].attributes[i].v2);
-                    troj.body[clip_bod[0]].attributes[i].v3 = troj.body[bod].attributes[i].v3 + t1 * (troj.body[clip_bod[0]].attributes[i].v3 - troj.body[bod].attributes[i].v3);
-                    troj.body[clip_bod[0]].attributes[i].v4 = troj.body[bod].attributes[i].v4 + t1 * (troj.body[clip_bod[0]].attributes[i].v4 - troj.body[bod].attributes[i].v4);
-                    troj.body[clip_bod[1]].attributes[i].v1 = troj.body[bod].attributes[i].v1 + t2 * (troj.body[clip_bod[1]].attributes[i].v1 - troj.body[bod].attributes[i].v1);
-                    troj.body[clip_bod[1]].attributes[i].v2 = troj.body[bod].attributes[i].v2 + t2 * (troj.body[clip_bod[1]].attributes[i].v2 - troj.body[bod].attributes[i].v2);
-                    troj.body[clip_bod[1]].attributes[i].v3 = troj.body[bod].attributes[i].v3 + t2 * (troj.body[clip_bod[1]].attributes[i].v3 - troj.body[bod].attributes[i].v3);
-                    troj.body[clip_bod[1]].attributes[i].v4 = troj.body[bod].attributes[i].v4 + t2 * (troj.body[clip_bod[1]].attributes[i].v4 - troj.body[bod].attributes[i].v4);
-                }
-                trojuholnik.push_back(troj);
+                glm::vec4 P = vrch_pozicie[troj.vrchol[bod]];
+                glm::vec4 P1 = vrch_pozicie[troj.vrchol[clip_bod[0]]];
+                glm::vec4 P2 = vrch_pozicie[troj.vrchol[clip_bod[1]]];
+                float citatel = -P.w - P.z;
+                float t1 = (citatel) / (P1.w - P.w + P1.z - P.z);
+                float t2 = (citatel) / (P2.w - P.w + P2.z - P.z);
+                troj.vrchol[clip_bod[0]] = lerpVertex(troj.vrchol[bod], troj.vrchol[clip_bod[0]], t1);
+                troj.vrchol[clip_bod[1]] = lerpVertex(troj.vrchol[bod], troj.vrchol[clip_bod[1]], t2);
+                emitTriangle(troj);
                 clip_bod.clear();
             }
             else
             {
-                trojuholnik.push_back(troj);
+                emitTriangle(troj);
                 clip_bod.clear();
             }
 
         }
+        GPU_STAT(statistiky.msClip += statMs(cas));
     }
-    
+}
+
+/**
+ * @brief This function finishes the current batch: perspective division, culling, setup and rasterization.
+ */
+void            GPU::finishBatch           (){
+    GPU_STAT(stat_cas cas = statTeraz());
+
+    // perspektivne delenie, kazdy vrchol sa deli raz aj ked ho zdiela viac trojuholnikov
+    for (int i = 0; i < vrch_pozicie.size(); i++)
+    {
+        glm::vec4& P = vrch_pozicie[i];
+        float w = P.w;
+        P.x = ((P.x / w) + 1) * (myframe.w / 2);
+        P.y = ((P.y / w) + 1) * (myframe.h / 2);
+        P.z = P.z / w;
+    }
+
+    // orezanie odvratenych a prazdnych trojuholnikov
+    int zostava = 0;
     for (int i = 0; i < trojuholnik.size(); i++)
     {
-        for (int j = 0; j < 3; j++)
+        if (!isCulled(trojuholnik[i]))
         {
-            float w = trojuholnik[i].body[j].gl_Position.w;
-            
-            trojuholnik[i].body[j].gl_Position.x = ((trojuholnik[i].body[j].gl_Position.x / w) + 1) * (myframe.w / 2);
-            trojuholnik[i].body[j].gl_Position.y = ((trojuholnik[i].body[j].gl_Position.y / w) + 1) * (myframe.h / 2);
-            trojuholnik[i].body[j].gl_Position.z = trojuholnik[i].body[j].gl_Position.z / w;
+            if (zostava != i)
+            {
+                trojuholnik[zostava] = trojuholnik[i];
+            }
+            zostava++;
         }
     }
-    
-    for (int i = 0; i < trojuholnik.size(); i++)
+    GPU_STAT(statistiky.trianglesCulled += trojuholnik.size() - zostava);
+    trojuholnik.resize(zostava);
+
+    // trojuholniky sa roztriedia do dlazdic, dlazdice sa potom rasterizuju paralelne
+    dlazdiceX = (myframe.w + tileSize - 1) / tileSize;
+    dlazdiceY = (myframe.h + tileSize - 1) / tileSize;
+    dlazdice.resize(dlazdiceX * dlazdiceY);
+    for (int i = 0; i < dlazdice.size(); i++)
     {
+        dlazdice[i].clear();
+    }
 
-
-        int bod; float h_min;
-        trojuholnik[i].body[0].gl_Position.y < trojuholnik[i].body[1].gl_Position.y ? bod = 0 : bod = 1;
-        trojuholnik[i].body[bod].gl_Position.y > trojuholnik[i].body[2].gl_Position.y ? bod = 2 : bod = bod;
-        h_min = trojuholnik[i].body[bod].gl_Position.y;
-        float h_max = std::max(trojuholnik[i].body[0].gl_Position.y, trojuholnik[i].body[1].gl_Position.y);
-        h_max = std::max(h_max, trojuholnik[i].body[2].gl_Position.y);
-        float center = trojuholnik[i].body[bod].gl_Position.x;
-
-        for (int h = (int)(std::round(h_min)); h < h_max; h++)
+    // nastavenie trojuholnikov, roviny maju pevnu velkost podla poctu premennych
+    nastavenia.resize(trojuholnik.size());
+    rovin_na_troj = 2 + zlozky_fs;
+    roviny.resize(trojuholnik.size() * rovin_na_troj * 3);
+    for (int i = 0; i < trojuholnik.size(); i++)
+    {
+        if (!setupTriangle(i))
+        {
+            continue;
+        }
+        nastavenie const& n = nastavenia[i];
+        for (int ty = n.hz / tileSize; ty <= (n.hk - 1) / tileSize; ty++)
         {
-            if (h >= 0 && h < myframe.h)
+            for (int tx = n.wz / tileSize; tx <= (n.wk - 1) / tileSize; tx++)
             {
-                float w_min = std::min(trojuholnik[i].body[0].gl_Position.x, trojuholnik[i].body[1].gl_Position.x);
-                w_min = std::min(w_min, trojuholnik[i].body[2].gl_Position.x);
-                float w_max = std::max(trojuholnik[i].body[0].gl_Position.x, trojuholnik[i].body[1].gl_Position.x);
-                w_max = std::max(w_max, trojuholnik[i].body[2].gl_Position.x);
-                (w_max - w_min) / 2 + w_min;
-                for (int w = (int)(std::round(w_min)); w < w_max; w++)
-                {
-                    if (w >= 0 && w < myframe.w)
-                    {
-                        float V1, V2, V3, V;
-
-                        if (0 <= (V = (trojuholnik[i].body[2].gl_Position.x - trojuholnik[i].body[0].gl_Position.x) * (trojuholnik[i].body[1].gl_Position.y - trojuholnik[i].body[0].gl_Position.y) - (trojuholnik[i].body[2].gl_Position.y - trojuholnik[i].body[0].gl_Position.y) * (trojuholnik[i].body[1].gl_Position.x - trojuholnik[i].body[0].gl_Position.x)))
-                        {
-                            if (0 <= (V3 = (w + 0.5f - trojuholnik[i].body[0].gl_Position.x) * (trojuholnik[i].body[1].gl_Position.y - trojuholnik[i].body[0].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[0].gl_Position.y) * (trojuholnik[i].body[1].gl_Position.x - trojuholnik[i].body[0].gl_Position.x)))
-                            {
-                                if (0 <= (V1 = (w + 0.5f - trojuholnik[i].body[1].gl_Position.x) * (trojuholnik[i].body[2].gl_Position.y - trojuholnik[i].body[1].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[1].gl_Position.y) * (trojuholnik[i].body[2].gl_Position.x - trojuholnik[i].body[1].gl_Position.x)))
-                                {
-                                    if (0 <= (V2 = (w + 0.5f - trojuholnik[i].body[2].gl_Position.x) * (trojuholnik[i].body[0].gl_Position.y - trojuholnik[i].body[2].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[2].gl_Position.y) * (trojuholnik[i].body[0].gl_Position.x - trojuholnik[i].body[2].gl_Position.x)))
-                                    {
-                                        int idx = h * myframe.w + w;
-
-
-                                        f = new InFragment[1];
-                                        c = new OutFragment[1];
-					c[0].gl_FragColor = glm::vec4(0, 0, 0, 0);
-
-                                        f[0].gl_FragCoord.x = w + 0.5f;
-                                        f[0].gl_FragCoord.y = h + 0.5f;
-                                        V1 = V1 / V;
-                                        V2 = V2 / V;
-                                        V3 = V3 / V;
-                                        float divisor = V1 / trojuholnik[i].body[0].gl_Position.w
-                                            + V2 / trojuholnik[i].body[1].gl_Position.w
-                                            + V3 / trojuholnik[i].body[2].gl_Position.w;
-                                        V1 = V1 / trojuholnik[i].body[0].gl_Position.w;
-                                        V2 = V2 / trojuholnik[i].body[1].gl_Position.w;
-                                        V3 = V3 / trojuholnik[i].body[2].gl_Position.w;
-                                        f[0].gl_FragCoord.z = (trojuholnik[i].body[0].gl_Position.z * V1 +
-                                            trojuholnik[i].body[1].gl_Position.z * V2 +
-                                            trojuholnik[i].body[2].gl_Position.z * V3) / divisor;
-                                        for(int p = 0; p < program_list[aktiv_prog]->atr_num.size();++p)
-                                        {
-                                            int num = program_list[aktiv_prog]->atr_num[p];
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::FLOAT)
-                                            {
-                                                f[0].attributes[num].v1 = (V1 * trojuholnik[i].body[0].attributes[num].v1 + V2 * trojuholnik[i].body[1].attributes[num].v1 + V3 * trojuholnik[i].body[2].attributes[num].v1) / (divisor);;
-
-
-
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC2)
-                                            {
-                                                f[0].attributes[num].v2[0] = (V1 * trojuholnik[i].body[0].attributes[num].v2[0] + V2 * trojuholnik[i].body[1].attributes[num].v2[0] + V3 * trojuholnik[i].body[2].attributes[num].v2[0]) / (divisor);
-                                                f[0].attributes[num].v2[1] = (V1 * trojuholnik[i].body[0].attributes[num].v2[1] + V2 * trojuholnik[i].body[1].attributes[num].v2[1] + V3 * trojuholnik[i].body[2].attributes[num].v2[1]) / (divisor);
-
-
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC3)
-                                            {
-                                                f[0].attributes[num].v3[0] = (V1 * trojuholnik[i].body[0].attributes[num].v3[0] + V2 * trojuholnik[i].body[1].attributes[num].v3[0] + V3 * trojuholnik[i].body[2].attributes[num].v3[0]) / divisor;
-                                                f[0].attributes[num].v3[1] = (V1 * trojuholnik[i].body[0].attributes[num].v3[1] + V2 * trojuholnik[i].body[1].attributes[num].v3[1] + V3 * trojuholnik[i].body[2].attributes[num].v3[1]) / divisor;
-                                                f[0].attributes[num].v3[2] = (V1 * trojuholnik[i].body[0].attributes[num].v3[2] + V2 * trojuholnik[i].body[1].attributes[num].v3[2] + V3 * trojuholnik[i].body[2].attributes[num].v3[2]) / divisor;
-                                                
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC4)
-                                            {
-                                                f[0].attributes[num].v4[0] = (V1 * trojuholnik[i].body[0].attributes[num].v4[0] + V2 * trojuholnik[i].body[1].attributes[num].v4[0] + V3 * trojuholnik[i].body[2].attributes[num].v4[0]) / divisor;
-                                                f[0].attributes[num].v4[1] = (V1 * trojuholnik[i].body[0].attributes[num].v4[1] + V2 * trojuholnik[i].body[1].attributes[num].v4[1] + V3 * trojuholnik[i].body[2].attributes[num].v4[1]) / divisor;
-                                                f[0].attributes[num].v4[2] = (V1 * trojuholnik[i].body[0].attributes[num].v4[2] + V2 * trojuholnik[i].body[1].attributes[num].v4[2] + V3 * trojuholnik[i].body[2].attributes[num].v4[2]) / divisor;
-                                                f[0].attributes[num].v4[3] = (V1 * trojuholnik[i].body[0].attributes[num].v4[3] + V2 * trojuholnik[i].body[1].attributes[num].v4[3] + V3 * trojuholnik[i].body[2].attributes[num].v4[3]) / divisor;
-
-                                            }
-                                        }
-                                        program_list[aktiv_prog]->fs(c[0], f[0], program_list[aktiv_prog]->premenne);
-
-                                        if (f[0].gl_FragCoord.z < myframe.hlbka[idx])
-                                        {
-
-                                            myframe.hlbka[idx] = f[0].gl_FragCoord.z;
-                                            idx *= 4;
-                                            for (int i = 0; i < 4; i++)
-                                            {
-                                                if (c[0].gl_FragColor[i] < 0)
-                                                {
-                                                    myframe.color[idx + i] = 0;
-                                                }
-                                                else if (c[0].gl_FragColor[i] > 1)
-                                                {
-                                                    myframe.color[idx + i] = 255;
-                                                }
-                                                else
-                                                {
-                                                    myframe.color[idx + i] = (int)(std::round(c[0].gl_FragColor[i] * 255));
-                                                }
-
-                                            }
-                                        }
-					delete [] f;
-					delete [] c;
-                                    }
-                                }
-                            }
-                        }
-                        else
-                        {
-
-                            if (0 <= (V3 = (w + 0.5f - trojuholnik[i].body[1].gl_Position.x) * (trojuholnik[i].body[0].gl_Position.y - trojuholnik[i].body[1].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[1].gl_Position.y) * (trojuholnik[i].body[0].gl_Position.x - trojuholnik[i].body[1].gl_Position.x)))
-                            {
-                                if (0 <= (V1 = (w + 0.5f - trojuholnik[i].body[2].gl_Position.x) * (trojuholnik[i].body[1].gl_Position.y - trojuholnik[i].body[2].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[2].gl_Position.y) * (trojuholnik[i].body[1].gl_Position.x - trojuholnik[i].body[2].gl_Position.x)))
-                                {
-                                    if (0 <= (V2 = (w + 0.5f - trojuholnik[i].body[0].gl_Position.x) * (trojuholnik[i].body[2].gl_Position.y - trojuholnik[i].body[0].gl_Position.y) - (h + 0.5f - trojuholnik[i].body[0].gl_Position.y) * (trojuholnik[i].body[2].gl_Position.x - trojuholnik[i].body[0].gl_Position.x)))
-                                    {
-                                        int idx = h * myframe.w + w;
-
-                                        V = -V;
-
-                                        f = new InFragment[1];
-                                        c = new OutFragment[1];
-					c[0].gl_FragColor = glm::vec4(0, 0, 0, 0);
-                                        f[0].gl_FragCoord.x = w + 0.5f;
-                                        f[0].gl_FragCoord.y = h + 0.5f;
-
-                                        V1 = V1 / V;
-                                        V2 = V2 / V;
-                                        V3 = V3 / V;
-                                        float divisor = V1 / trojuholnik[i].body[0].gl_Position.w
-                                            + V2 / trojuholnik[i].body[1].gl_Position.w
-                                            + V3 / trojuholnik[i].body[2].gl_Position.w;
-                                        V1 = V1 / trojuholnik[i].body[0].gl_Position.w;
-                                        V2 = V2 / trojuholnik[i].body[1].gl_Position.w;
-                                        V3 = V3 / trojuholnik[i].body[2].gl_Position.w;
-                                        f[0].gl_FragCoord.z = (trojuholnik[i].body[0].gl_Position.z * V1 +
-                                            trojuholnik[i].body[1].gl_Position.z * V2 +
-                                            trojuholnik[i].body[2].gl_Position.z * V3) / divisor;
-                                        for (int p = 0; p < program_list[aktiv_prog]->atr_num.size(); ++p)
-                                        {
-                                            int num = program_list[aktiv_prog]->atr_num[p];
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::FLOAT)
-                                            {
-                                                f[0].attributes[num].v1 = (V1 * trojuholnik[i].body[0].attributes[num].v1 + V2 * trojuholnik[i].body[1].attributes[num].v1 + V3 * trojuholnik[i].body[2].attributes[num].v1) / (divisor);;
-
-
-
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC2)
-                                            {
-                                                f[0].attributes[num].v2[0] = (V1 * trojuholnik[i].body[0].attributes[num].v2[0] + V2 * trojuholnik[i].body[1].attributes[num].v2[0] + V3 * trojuholnik[i].body[2].attributes[num].v2[0]) / (divisor);
-                                                f[0].attributes[num].v2[1] = (V1 * trojuholnik[i].body[0].attributes[num].v2[1] + V2 * trojuholnik[i].body[1].attributes[num].v2[1] + V3 * trojuholnik[i].body[2].attributes[num].v2[1]) / (divisor);
-
-
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC3)
-                                            {
-                                                f[0].attributes[num].v3[0] = (V1 * trojuholnik[i].body[0].attributes[num].v3[0] + V2 * trojuholnik[i].body[1].attributes[num].v3[0] + V3 * trojuholnik[i].body[2].attributes[num].v3[0]) / divisor;
-                                                f[0].attributes[num].v3[1] = (V1 * trojuholnik[i].body[0].attributes[num].v3[1] + V2 * trojuholnik[i].body[1].attributes[num].v3[1] + V3 * trojuholnik[i].body[2].attributes[num].v3[1]) / divisor;
-                                                f[0].attributes[num].v3[2] = (V1 * trojuholnik[i].body[0].attributes[num].v3[2] + V2 * trojuholnik[i].body[1].attributes[num].v3[2] + V3 * trojuholnik[i].body[2].attributes[num].v3[2]) / divisor;
-
-                                            }
-                                            if (program_list[aktiv_prog]->type[p] == (int)AttributeType::VEC4)
-                                            {
-                                                f[0].attributes[num].v4[0] = (V1 * trojuholnik[i].body[0].attributes[num].v4[0] + V2 * trojuholnik[i].body[1].attributes[num].v4[0] + V3 * trojuholnik[i].body[2].attributes[num].v4[0]) / divisor;
-                                                f[0].attributes[num].v4[1] = (V1 * trojuholnik[i].body[0].attributes[num].v4[1] + V2 * trojuholnik[i].body[1].attributes[num].v4[1] + V3 * trojuholnik[i].body[2].attributes[num].v4[1]) / divisor;
-                                                f[0].attributes[num].v4[2] = (V1 * trojuholnik[i].body[0].attributes[num].v4[2] + V2 * trojuholnik[i].body[1].attributes[num].v4[2] + V3 * trojuholnik[i].body[2].attributes[num].v4[2]) / divisor;
-                                                f[0].attributes[num].v4[3] = (V1 * trojuholnik[i].body[0].attributes[num].v4[3] + V2 * trojuholnik[i].body[1].attributes[num].v4[3] + V3 * trojuholnik[i].body[2].attributes[num].v4[3]) / divisor;
-
-                                            }
-                                        }
-                                        program_list[aktiv_prog]->fs(c[0], f[0], program_list[aktiv_prog]->premenne);
-
-
-                                        if (f[0].gl_FragCoord.z < myframe.hlbka[idx])
-                                        {
-
-                                            myframe.hlbka[idx] = f[0].gl_FragCoord.z;
-                                            idx *= 4;
-                                            for (int i = 0; i < 4; i++)
-                                            {
-                                                if (c[0].gl_FragColor[i] < 0)
-                                                {
-                                                    myframe.color[idx + i] = 0;
-                                                }
-                                                else if (c[0].gl_FragColor[i] > 1)
-                                                {
-                                                    myframe.color[idx + i] = 255;
-                                                }
-                                                else
-                                                {
-                                                    myframe.color[idx + i] = (int)(std::round(c[0].gl_FragColor[i] * 255));
-                                                }
-                                            }
-                                        }
-					delete [] f;
-					delete [] c;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                dlazdice[ty * dlazdiceX + tx].push_back(i);
             }
         }
     }
 
+    GPU_STAT(statistiky.msSetup += statMs(cas));
+    runParallel(&GPU::rasterizeTile, (uint32_t)dlazdice.size());
+}
 
+/**
+ * @brief This function computes frustum and guard band planes for the current framebuffer.
+ *
+ * Planes are stored as limits of x/w and y/w.
+ * Right and top limits follow the viewport transformation (x/w + 1) * (width / 2), which maps
+ * x/w = 1 one pixel before the edge for odd sizes, and they are enlarged by a small margin so that
+ * a rejected triangle can never cover a pixel center.
+ */
+void            GPU::setupFrustumPlanes    (){
+    float pol_w = (float)std::max(myframe.w / 2, 1);
+    float pol_h = (float)std::max(myframe.h / 2, 1);
+    frustum_vpravo = myframe.w / pol_w - 1.f + 1e-3f;
+    frustum_hore = myframe.h / pol_h - 1.f + 1e-3f;
+    guard_vlavo = -guardBand / pol_w - 1.f;
+    guard_vpravo = (myframe.w + guardBand) / pol_w - 1.f;
+    guard_dole = -guardBand / pol_h - 1.f;
+    guard_hore = (myframe.h + guardBand) / pol_h - 1.f;
+}
 
-    
+/**
+ * @brief This function tests if triangle in clip space lies completely outside of one of the frustum planes.
+ *
+ * Only triangles in front of the camera (all w > 0) are tested, the near plane is handled by clipping.
+ *
+ * @param troj triangle in clip space
+ *
+ * @return true if the triangle cannot produce any fragment
+ */
+bool            GPU::isOutsideFrustum      (trojuhol const& troj){
+    glm::vec4 const& A = vrch_pozicie[troj.vrchol[0]];
+    glm::vec4 const& B = vrch_pozicie[troj.vrchol[1]];
+    glm::vec4 const& C = vrch_pozicie[troj.vrchol[2]];
+    if (!(0 < A.w && 0 < B.w && 0 < C.w))
+    {
+        return false;
+    }
+    return (A.x < -A.w && B.x < -B.w && C.x < -C.w) ||
+        (A.y < -A.w && B.y < -B.w && C.y < -C.w) ||
+        (A.x > frustum_vpravo * A.w && B.x > frustum_vpravo * B.w && C.x > frustum_vpravo * C.w) ||
+        (A.y > frustum_hore * A.w && B.y > frustum_hore * B.w && C.y > frustum_hore * C.w) ||
+        (A.z > A.w && B.z > B.w && C.z > C.w);
+}
 
+/**
+ * @brief This function collects varyings declared by setVS2FSType for the compact vertex layout.
+ *
+ * Only these attributes are kept after vertex shader, every vertex stores
+ * their components packed one after another.
+ */
+void            GPU::prepareVaryings       (){
+    premenne_fs.clear();
+    zlozky_fs = 0;
+    program* prog = program_list[aktiv_prog];
+    for (int p = 0; p < prog->atr_num.size(); p++)
+    {
+        premenna_fs v;
+        v.atribut = prog->atr_num[p];
+        v.zlozky = prog->type[p] >= (int)AttributeType::FLOAT && prog->type[p] <= (int)AttributeType::VEC4 ? prog->type[p] : 0;
+        if (v.zlozky == 0 || v.atribut >= maxAttributes)
+        {
+            continue;
+        }
+        premenne_fs.push_back(v);
+        zlozky_fs += v.zlozky;
+    }
+}
+
+/**
+ * @brief This function stores output of vertex shader in the compact vertex layout.
+ *
+ * @param vrchol output of vertex shader
+ *
+ * @return index of the stored vertex
+ */
+uint32_t        GPU::storeVertex           (OutVertex const& vrchol){
+    uint32_t idx = (uint32_t)vrch_pozicie.size();
+    vrch_pozicie.push_back(vrchol.gl_Position);
+    vrch_premenne.resize(vrch_premenne.size() + zlozky_fs);
+    float* ciel = &vrch_premenne[idx * zlozky_fs];
+    for (int p = 0; p < premenne_fs.size(); p++)
+    {
+        memcpy(ciel, &vrchol.attributes[premenne_fs[p].atribut].v4[0], premenne_fs[p].zlozky * sizeof(float));
+        ciel += premenne_fs[p].zlozky;
+    }
+    return idx;
+}
+
+/**
+ * @brief This function creates new vertex on the line between two stored vertices.
+ *
+ * @param a index of first vertex
+ * @param b index of second vertex
+ * @param t parameter of the line, 0 gives a, 1 gives b
+ *
+ * @return index of the new vertex
+ */
+uint32_t        GPU::lerpVertex            (uint32_t a,uint32_t b,float t){
+    uint32_t idx = (uint32_t)vrch_pozicie.size();
+    glm::vec4 A = vrch_pozicie[a];
+    glm::vec4 B = vrch_pozicie[b];
+    vrch_pozicie.push_back(A + t * (B - A));
+    vrch_premenne.resize(vrch_premenne.size() + zlozky_fs);
+    float const* pa = &vrch_premenne[a * zlozky_fs];
+    float const* pb = &vrch_premenne[b * zlozky_fs];
+    float* ciel = &vrch_premenne[idx * zlozky_fs];
+    for (uint32_t k = 0; k < zlozky_fs; k++)
+    {
+        ciel[k] = pa[k] + t * (pb[k] - pa[k]);
+    }
+    return idx;
+}
+
+/**
+ * @brief This function adds triangle in clip space to the list of triangles for rasterization.
+ *
+ * Triangles that cross the frustum sides are rasterized without clipping, the bounding box is clamped
+ * to the framebuffer. Only triangles that reach beyond the guard band (guardBand pixels around the
+ * framebuffer) are clipped, so that screen space coordinates stay in the range where edge functions are precise.
+ *
+ * @param troj triangle in clip space
+ */
+void            GPU::emitTriangle          (trojuhol const& troj){
+    bool vnutri = true;
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec4 const& P = vrch_pozicie[troj.vrchol[i]];
+        vnutri = vnutri && !(P.x < guard_vlavo * P.w || P.x > guard_vpravo * P.w || P.y < guard_dole * P.w || P.y > guard_hore * P.w);
+    }
+    glm::vec4 const& A = vrch_pozicie[troj.vrchol[0]];
+    glm::vec4 const& B = vrch_pozicie[troj.vrchol[1]];
+    glm::vec4 const& C = vrch_pozicie[troj.vrchol[2]];
+    if (vnutri || !(0 < A.w && 0 < B.w && 0 < C.w))
+    {
+        trojuholnik.push_back(troj);
+        return;
+    }
+    GPU_STAT(statistiky.trianglesClipped++);
+
+    // Sutherland-Hodgman orezanie styrmi rovinami ochranneho pasu, vysledok sa rozlozi na vejar
+    uint32_t mnohouholnik[2][3 + 4];
+    int n = 3;
+    for (int i = 0; i < 3; i++)
+    {
+        mnohouholnik[0][i] = troj.vrchol[i];
+    }
+    float roviny[4][3] = { { 1.f, 0.f, -guard_vlavo }, { -1.f, 0.f, guard_vpravo }, { 0.f, 1.f, -guard_dole }, { 0.f, -1.f, guard_hore } };
+    int zdroj = 0;
+    for (int r = 0; r < 4 && n > 0; r++)
+    {
+        int m = 0;
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t a = mnohouholnik[zdroj][i];
+            uint32_t b = mnohouholnik[zdroj][(i + 1) % n];
+            glm::vec4 const& Pa = vrch_pozicie[a];
+            glm::vec4 const& Pb = vrch_pozicie[b];
+            float da = roviny[r][0] * Pa.x + roviny[r][1] * Pa.y + roviny[r][2] * Pa.w;
+            float db = roviny[r][0] * Pb.x + roviny[r][1] * Pb.y + roviny[r][2] * Pb.w;
+            if (da >= 0)
+            {
+                mnohouholnik[1 - zdroj][m++] = a;
+            }
+            if ((da >= 0) != (db >= 0))
+            {
+                mnohouholnik[1 - zdroj][m++] = lerpVertex(a, b, da / (da - db));
+            }
+        }
+        n = m;
+        zdroj = 1 - zdroj;
+    }
+    for (int i = 1; i + 1 < n; i++)
+    {
+        trojuhol t;
+        t.vrchol[0] = mnohouholnik[zdroj][0];
+        t.vrchol[1] = mnohouholnik[zdroj][i];
+        t.vrchol[2] = mnohouholnik[zdroj][i + 1];
+        trojuholnik.push_back(t);
+    }
+}
+
+/**
+ * @brief This function decides if triangle in screen space is discarded before rasterization.
+ *
+ * Triangles with zero area and triangles whose bounding box does not contain any pixel center
+ * are always discarded, front or back facing triangles are discarded according to setCullFace.
+ *
+ * @param troj triangle after perspective division and viewport transformation
+ *
+ * @return true if the triangle is discarded
+ */
+bool            GPU::isCulled              (trojuhol const& troj){
+    glm::vec4 const& A = vrch_pozicie[troj.vrchol[0]];
+    glm::vec4 const& B = vrch_pozicie[troj.vrchol[1]];
+    glm::vec4 const& C = vrch_pozicie[troj.vrchol[2]];
+
+    // rovnaky vyraz ako pri rasterizacii, V < 0 pre trojuholnik proti smeru hodinovych ruciciek
+    float V = (C.x - A.x) * (B.y - A.y) - (C.y - A.y) * (B.x - A.x);
+    if (!(V != 0))
+    {
+        return true;
+    }
+    if (!(std::round(std::min(std::min(A.y, B.y), C.y)) < std::max(std::max(A.y, B.y), C.y)) ||
+        !(std::round(std::min(std::min(A.x, B.x), C.x)) < std::max(std::max(A.x, B.x), C.x)))
+    {
+        return true;
+    }
+    if (cull_face == CullFace::NONE)
+    {
+        return false;
+    }
+    bool predny = front_face == FrontFace::CCW ? V < 0 : V > 0;
+    return cull_face == CullFace::FRONT_AND_BACK || (cull_face == CullFace::FRONT) == predny;
+}
+
+/**
+ * @brief This function rasterizes all triangles binned into one screen tile.
+ *
+ * Triangles are processed in submission order, so every pixel sees the same
+ * sequence of depth tests and writes as with a single thread.
+ *
+ * @param tile index of the tile
+ * @param vlakno index of the thread that processes the tile
+ */
+void            GPU::rasterizeTile         (uint32_t tile,uint32_t vlakno){
+    int x0 = (tile % dlazdiceX) * tileSize;
+    int y0 = (tile / dlazdiceX) * tileSize;
+    int x1 = std::min(x0 + tileSize, myframe.w);
+    int y1 = std::min(y0 + tileSize, myframe.h);
+    GPU_STAT(stat_cas cas = statTeraz());
+    if (dlazdice[tile].size() > 0)
+    {
+        resolveTileClear(tile, zmazatFarbu | zmazatHlbku);
+    }
+    pamat_vlakien[vlakno].zapisane_bloky = 0;
+    bool stvorice = quad_shading || program_list[aktiv_prog]->fs_batch != NULL;
+    for (int i = 0; i < dlazdice[tile].size(); i++)
+    {
+        if (stvorice)
+        {
+            rasterizeTriangleQuads(dlazdice[tile][i], x0, y0, x1, y1, vlakno);
+        }
+        else
+        {
+            rasterizeTriangle(dlazdice[tile][i], x0, y0, x1, y1, vlakno);
+        }
+    }
+    // maximum hlbky bloku moze po zapise klesnut, prepocita sa raz za dlazdicu
+    updateHiZ(x0, y0, pamat_vlakien[vlakno].zapisane_bloky);
+    GPU_STAT(pamat_vlakien[vlakno].statistiky.msRaster += statMs(cas));
+}
+
+#if !GPU_X86
+/**
+ * @brief This function evaluates edge functions of 8 neighbouring pixels of one row, scalar version.
+ *
+ * Value of edge k in pixel w is (w + 0.5 - ax) * dy - riadok, which is the
+ * same expression (and rounding) as the full edge function, only the part
+ * that depends on the row is computed once per row.
+ *
+ * @param e three edges prepared for the row
+ * @param w column of the first pixel
+ * @param hodnoty output, 8 values of every edge
+ *
+ * @return coverage mask, bit l is set if pixel w + l lies inside of all edges
+ */
+static uint32_t pokrytie8Skalar(GPU::hrana_riadku const* e, int w, float* hodnoty)
+{
+    uint32_t maska = 0;
+    for (int l = 0; l < 8; l++)
+    {
+        bool vnutri = true;
+        for (int k = 0; k < 3; k++)
+        {
+            float v = ((w + l) + 0.5f - e[k].ax) * e[k].dy - e[k].riadok;
+            hodnoty[k * 8 + l] = v;
+            vnutri = vnutri && 0 <= v;
+        }
+        if (vnutri)
+        {
+            maska |= 1u << l;
+        }
+    }
+    return maska;
+}
+#endif
+
+#if GPU_X86
+/**
+ * @brief SSE version of pokrytie8Skalar, evaluates two quads of 4 pixels.
+ */
+static uint32_t pokrytie8SSE(GPU::hrana_riadku const* e, int w, float* hodnoty)
+{
+    __m128 const nula = _mm_setzero_ps();
+    uint32_t maska = 0;
+    for (int q = 0; q < 2; q++)
+    {
+        __m128 px = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(w + 4 * q), _mm_setr_epi32(0, 1, 2, 3))), _mm_set1_ps(0.5f));
+        __m128 vnutri = _mm_cmpeq_ps(nula, nula);
+        for (int k = 0; k < 3; k++)
+        {
+            __m128 v = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(px, _mm_set1_ps(e[k].ax)), _mm_set1_ps(e[k].dy)), _mm_set1_ps(e[k].riadok));
+            _mm_storeu_ps(hodnoty + k * 8 + 4 * q, v);
+            vnutri = _mm_and_ps(vnutri, _mm_cmple_ps(nula, v));
+        }
+        maska |= (uint32_t)_mm_movemask_ps(vnutri) << (4 * q);
+    }
+    return maska;
+}
+
+/**
+ * @brief AVX2 version of pokrytie8Skalar, evaluates all 8 pixels at once.
+ */
+GPU_TARGET_AVX2 static uint32_t pokrytie8AVX2(GPU::hrana_riadku const* e, int w, float* hodnoty)
+{
+    __m256 const nula = _mm256_setzero_ps();
+    __m256 px = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(w), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))), _mm256_set1_ps(0.5f));
+    __m256 vnutri = _mm256_cmp_ps(nula, nula, _CMP_EQ_OQ);
+    for (int k = 0; k < 3; k++)
+    {
+        __m256 v = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(px, _mm256_set1_ps(e[k].ax)), _mm256_set1_ps(e[k].dy)), _mm256_set1_ps(e[k].riadok));
+        _mm256_storeu_ps(hodnoty + k * 8, v);
+        vnutri = _mm256_and_ps(vnutri, _mm256_cmp_ps(nula, v, _CMP_LE_OQ));
+    }
+    return (uint32_t)_mm256_movemask_ps(vnutri);
+}
+
+/**
+ * @brief This function tests if the CPU and the OS support AVX2.
+ */
+static bool podporaAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/**
+ * @brief This function selects the fastest edge evaluation supported by the CPU.
+ */
+static GPU::pokrytie8 vyberPokrytie8()
+{
+#if GPU_X86
+    if (podporaAVX2())
+    {
+        return pokrytie8AVX2;
+    }
+    return pokrytie8SSE;
+#else
+    return pokrytie8Skalar;
+#endif
+}
+
+/**
+ * @brief This function computes data of one triangle shared by all tiles it covers.
+ *
+ * Edges are oriented so that covered pixels have non-negative edge values.
+ * Planes q(x,y) = q0 + dq/dx * (x - x0) + dq/dy * (y - y0) relative to the first vertex
+ * are computed for 1/w, z/w and every varying component divided by w, so
+ * perspective correct interpolation needs only one division per fragment.
+ *
+ * @param i index of triangle in screen space
+ *
+ * @return false if the triangle does not cover any pixel center of the framebuffer
+ */
+bool            GPU::setupTriangle         (uint32_t i){
+    trojuhol const& troj = trojuholnik[i];
+    nastavenie& n = nastavenia[i];
+    glm::vec4 const& A = vrch_pozicie[troj.vrchol[0]];
+    glm::vec4 const& B = vrch_pozicie[troj.vrchol[1]];
+    glm::vec4 const& C = vrch_pozicie[troj.vrchol[2]];
+
+    // riadky h < h_max a stlpce w < w_max, orezane na framebuffer
+    float h_start = std::max(std::round(std::min(std::min(A.y, B.y), C.y)), 0.f);
+    float h_end = std::min(std::ceil(std::max(std::max(A.y, B.y), C.y)), (float)myframe.h);
+    float w_start = std::max(std::round(std::min(std::min(A.x, B.x), C.x)), 0.f);
+    float w_end = std::min(std::ceil(std::max(std::max(A.x, B.x), C.x)), (float)myframe.w);
+    if (!(h_start < h_end) || !(w_start < w_end))
+    {
+        return false;
+    }
+    n.hz = (int)h_start;
+    n.hk = (int)h_end;
+    n.wz = (int)w_start;
+    n.wk = (int)w_end;
+
+    // pri zapornej ploche sa hrany vyhodnocuju s prehodenymi vrcholmi
+    float V = (C.x - A.x) * (B.y - A.y) - (C.y - A.y) * (B.x - A.x);
+    int hrany[3][2] = { { 1, 2 }, { 2, 0 }, { 0, 1 } };
+    if (!(0 <= V))
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            std::swap(hrany[k][0], hrany[k][1]);
+        }
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        glm::vec4 const& a = vrch_pozicie[troj.vrchol[hrany[k][0]]];
+        glm::vec4 const& b = vrch_pozicie[troj.vrchol[hrany[k][1]]];
+        n.e[k].ax = a.x;
+        n.e[k].ay = a.y;
+        n.e[k].dx = b.x - a.x;
+        n.e[k].dy = b.y - a.y;
+    }
+
+    // interpolovana hlbka je konvexna kombinacia hlbok vrcholov, len ak maju vsetky w rovnake znamienko
+    n.hiz = early_z && ((0 < A.w && 0 < B.w && 0 < C.w) || (A.w < 0 && B.w < 0 && C.w < 0));
+    float z_min = std::min(std::min(A.z, B.z), C.z);
+    float z_max = std::max(std::max(A.z, B.z), C.z);
+    float rezerva = 1e-5f * (1.f + std::max(std::fabs(z_min), std::fabs(z_max)));
+    n.z_odmietni = z_min - rezerva;
+    n.z_prijmi = z_max + rezerva;
+
+    // roviny hodnot delenych w, pocitane relativne k prvemu vrcholu
+    n.x0 = A.x;
+    n.y0 = A.y;
+    float x1 = B.x - A.x, y1 = B.y - A.y;
+    float x2 = C.x - A.x, y2 = C.y - A.y;
+    float inv_D = 1.f / (x1 * y2 - x2 * y1);
+    float rw[3] = { 1.f / A.w, 1.f / B.w, 1.f / C.w };
+    float* r = &roviny[i * rovin_na_troj * 3];
+    float q[3];
+    for (uint32_t k = 0; k < rovin_na_troj; k++, r += 3)
+    {
+        for (int v = 0; v < 3; v++)
+        {
+            if (k == 0)
+            {
+                q[v] = rw[v];
+            }
+            else if (k == 1)
+            {
+                q[v] = vrch_pozicie[troj.vrchol[v]].z * rw[v];
+            }
+            else
+            {
+                q[v] = vrch_premenne[troj.vrchol[v] * zlozky_fs + k - 2] * rw[v];
+            }
+        }
+        float q1 = q[1] - q[0], q2 = q[2] - q[0];
+        r[0] = q[0];
+        r[1] = (q1 * y2 - q2 * y1) * inv_D;
+        r[2] = (q2 * x1 - q1 * x2) * inv_D;
+    }
+    return true;
+}
+
+/**
+ * @brief This function clips bounding box of a triangle to a rectangle and tests it against coarse depth buffer.
+ *
+ * @param n data of triangle from setupTriangle
+ * @param hz first row, on input the first row of the rectangle
+ * @param hk row after the last row, on input the row after the rectangle
+ * @param wz first column, on input the first column of the rectangle
+ * @param wk column after the last column, on input the column after the rectangle
+ *
+ * @return false if the triangle cannot produce any visible fragment inside of the rectangle
+ */
+bool            GPU::clipTriangleToTile    (nastavenie const& n,int& hz,int& hk,int& wz,int& wk){
+    hz = std::max(n.hz, hz);
+    hk = std::min(n.hk, hk);
+    wz = std::max(n.wz, wz);
+    wk = std::min(n.wk, wk);
+    if (!(hz < hk) || !(wz < wk))
+    {
+        return false;
+    }
+    if (n.hiz)
+    {
+        for (int by = hz / hizSize; by <= (hk - 1) / hizSize; by++)
+        {
+            for (int bx = wz / hizSize; bx <= (wk - 1) / hizSize; bx++)
+            {
+                if (n.z_odmietni < myframe.hiz_max[by * myframe.hiz_w + bx])
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief This function writes depth and color of a fragment that passed depth test.
+ *
+ * @param idx index of pixel
+ * @param hb index of block of coarse depth buffer that contains the pixel
+ * @param z depth of fragment
+ * @param vystup output of fragment shader, color is clamped to 0 - 1
+ */
+void            GPU::writeFragment         (int idx,int hb,float z,OutFragment const& vystup){
+    myframe.hlbka[idx] = z;
+    myframe.hiz_min[hb] = std::min(myframe.hiz_min[hb], z);
+    idx *= 4;
+    for (int i = 0; i < 4; i++)
+    {
+        if (vystup.gl_FragColor[i] < 0)
+        {
+            myframe.color[idx + i] = 0;
+        }
+        else if (vystup.gl_FragColor[i] > 1)
+        {
+            myframe.color[idx + i] = 255;
+        }
+        else
+        {
+            myframe.color[idx + i] = (int)(std::round(vystup.gl_FragColor[i] * 255));
+        }
+    }
+}
+
+/**
+ * @brief This function rasterizes part of one triangle that lies inside of the rectangle x0,y0 - x1,y1.
+ *
+ * Coverage is evaluated for 8 pixels of a row at once, see pokrytie8Skalar.
+ * Depth and varyings are evaluated from planes prepared by setupTriangle.
+ *
+ * @param i index of triangle, it has to be prepared by setupTriangle
+ * @param x0 first column of the rectangle
+ * @param y0 first row of the rectangle
+ * @param x1 column after the last column of the rectangle
+ * @param y1 row after the last row of the rectangle
+ * @param vlakno index of the thread, selects fragment storage of the thread
+ */
+void            GPU::rasterizeTriangle     (uint32_t i,int x0,int y0,int x1,int y1,uint32_t vlakno){
+    nastavenie const& n = nastavenia[i];
+    float const* r = &roviny[i * rovin_na_troj * 3];
+    GPU_STAT(GPUStatistics& stat = pamat_vlakien[vlakno].statistiky);
+
+    int hz = y0, hk = y1, wz = x0, wk = x1;
+    if (!clipTriangleToTile(n, hz, hk, wz, wk))
+    {
+        return;
+    }
+    hrana_riadku e[3];
+    for (int k = 0; k < 3; k++)
+    {
+        e[k].ax = n.e[k].ax;
+        e[k].dy = n.e[k].dy;
+    }
+
+    program* prog = program_list[aktiv_prog];
+    InFragment* f = &pamat_vlakien[vlakno].fragment;
+    OutFragment* c = &pamat_vlakien[vlakno].vystup;
+    float hodnoty[3 * 8];
+    float riadok[2 + 4 * maxAttributes];
+
+    for (int h = hz; h < hk; h++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            e[k].riadok = (h + 0.5f - n.e[k].ay) * n.e[k].dx;
+        }
+        // hodnoty rovin na zaciatku riadku, v pixeli sa pripocita uz len derivacia podla x
+        float dy = h + 0.5f - n.y0;
+        for (uint32_t k = 0; k < rovin_na_troj; k++)
+        {
+            riadok[k] = r[3 * k] + r[3 * k + 2] * dy;
+        }
+        // 8 pixelov je zarovnanych na blok hrubych hlbok
+        for (int blok = wz & ~(hizSize - 1); blok < wk; blok += 8)
+        {
+            int hb = (h / hizSize) * myframe.hiz_w + blok / hizSize;
+            if (n.hiz && !(n.z_odmietni < myframe.hiz_max[hb]))
+            {
+                continue;
+            }
+            bool vsetky_prejdu = n.hiz && n.z_prijmi < myframe.hiz_min[hb];
+
+            uint32_t maska = pokrytie(e, blok, hodnoty);
+            if (blok < wz)
+            {
+                maska &= ~((1u << (wz - blok)) - 1);
+            }
+            if (wk - blok < 8)
+            {
+                maska &= (1u << (wk - blok)) - 1;
+            }
+            for (int l = 0; maska != 0; l++, maska >>= 1)
+            {
+                if (!(maska & 1))
+                {
+                    continue;
+                }
+                int w = blok + l;
+                int idx = h * myframe.w + w;
+
+                c[0].gl_FragColor = glm::vec4(0, 0, 0, 0);
+                f[0].gl_FragCoord.x = w + 0.5f;
+                f[0].gl_FragCoord.y = h + 0.5f;
+
+                float dx = w + 0.5f - n.x0;
+                float w_frag = 1.f / (riadok[0] + r[1] * dx);
+                f[0].gl_FragCoord.z = (riadok[1] + r[4] * dx) * w_frag;
+                bool prejde = vsetky_prejdu || f[0].gl_FragCoord.z < myframe.hlbka[idx];
+                GPU_STAT(stat.fragmentsGenerated++; stat.fragmentsDepthKilled += !prejde);
+                if (early_z && !prejde)
+                {
+                    continue;
+                }
+                // premenne su v kompaktnom rozlozeni v poradi z setVS2FSType
+                int k = 2;
+                for (int p = 0; p < premenne_fs.size(); ++p)
+                {
+                    Attribute& ciel = f[0].attributes[premenne_fs[p].atribut];
+                    for (uint32_t z = 0; z < premenne_fs[p].zlozky; z++, k++)
+                    {
+                        ciel.v4[z] = (riadok[k] + r[3 * k + 1] * dx) * w_frag;
+                    }
+                }
+                GPU_STAT(stat_cas cas = statTeraz());
+                prog->fs(c[0], f[0], prog->premenne);
+                GPU_STAT(stat.msFS += statMs(cas));
+
+                if (prejde)
+                {
+                    writeFragment(idx, hb, f[0].gl_FragCoord.z, c[0]);
+                    pamat_vlakien[vlakno].zapisane_bloky |= (uint64_t)1 << (((h - y0) / hizSize) * 8 + (blok - x0) / hizSize);
+                    GPU_STAT(stat.fragmentsWritten++; stat.msROP += statMs(cas));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief This function rasterizes part of one triangle inside of the rectangle x0,y0 - x1,y1 in 2x2 quads.
+ *
+ * Quads are aligned to even rows and columns. Every quad with at least one covered
+ * pixel that passes early depth test is interpolated in all four pixels, uncovered
+ * pixels are helpers that are shaded (by batched shader) but never written.
+ * Without batched shader, only covered pixels are shaded one by one and the result
+ * is the same as with rasterizeTriangle.
+ *
+ * @param i index of triangle, it has to be prepared by setupTriangle
+ * @param x0 first column of the rectangle
+ * @param y0 first row of the rectangle
+ * @param x1 column after the last column of the rectangle
+ * @param y1 row after the last row of the rectangle
+ * @param vlakno index of the thread, selects fragment storage of the thread
+ */
+void            GPU::rasterizeTriangleQuads(uint32_t i,int x0,int y0,int x1,int y1,uint32_t vlakno){
+    nastavenie const& n = nastavenia[i];
+    float const* r = &roviny[i * rovin_na_troj * 3];
+    vlakno_data& pamat = pamat_vlakien[vlakno];
+    GPU_STAT(GPUStatistics& stat = pamat.statistiky);
+
+    int hz = y0, hk = y1, wz = x0, wk = x1;
+    if (!clipTriangleToTile(n, hz, hk, wz, wk))
+    {
+        return;
+    }
+    hrana_riadku e[2][3];
+    for (int k = 0; k < 3; k++)
+    {
+        e[0][k].ax = e[1][k].ax = n.e[k].ax;
+        e[0][k].dy = e[1][k].dy = n.e[k].dy;
+    }
+
+    program* prog = program_list[aktiv_prog];
+    float hodnoty[3 * 8];
+    float riadok[2][2 + 4 * maxAttributes];
+    pamat.davka_pocet = 0;
+
+    // dlazdice zacinaju na parnom riadku, stvorice nezasahuju do vedlajsich dlazdic
+    for (int h = hz & ~1; h < hk; h += 2)
+    {
+        for (int v = 0; v < 2; v++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                e[v][k].riadok = (h + v + 0.5f - n.e[k].ay) * n.e[k].dx;
+            }
+            float dy = h + v + 0.5f - n.y0;
+            for (uint32_t k = 0; k < rovin_na_troj; k++)
+            {
+                riadok[v][k] = r[3 * k] + r[3 * k + 2] * dy;
+            }
+        }
+        for (int blok = wz & ~(hizSize - 1); blok < wk; blok += 8)
+        {
+            int hb = (h / hizSize) * myframe.hiz_w + blok / hizSize;
+            if (n.hiz && !(n.z_odmietni < myframe.hiz_max[hb]))
+            {
+                continue;
+            }
+            bool vsetky_prejdu = n.hiz && n.z_prijmi < myframe.hiz_min[hb];
+
+            uint32_t stlpce = 0xff;
+            if (blok < wz)
+            {
+                stlpce &= ~((1u << (wz - blok)) - 1);
+            }
+            if (wk - blok < 8)
+            {
+                stlpce &= (1u << (wk - blok)) - 1;
+            }
+            uint32_t maska[2] = { 0, 0 };
+            for (int v = 0; v < 2; v++)
+            {
+                if (h + v >= hz && h + v < hk)
+                {
+                    maska[v] = pokrytie(e[v], blok, hodnoty) & stlpce;
+                }
+            }
+            for (int q = 0; q < 4; q++)
+            {
+                // pixel l stvorice je (blok + 2q + l % 2, h + l / 2)
+                uint32_t pokryte = ((maska[0] >> (2 * q)) & 3) | (((maska[1] >> (2 * q)) & 3) << 2);
+                if (pokryte == 0)
+                {
+                    continue;
+                }
+                uint32_t zive = 0;
+                uint32_t prvy = pamat.davka_pocet;
+                for (int l = 0; l < 4; l++)
+                {
+                    int w = blok + 2 * q + (l & 1);
+                    int v = l >> 1;
+                    InFragment& f = pamat.davka_vstup[prvy + l];
+                    vlakno_data::rop& rop = pamat.davka_rop[prvy + l];
+                    f.gl_FragCoord.x = w + 0.5f;
+                    f.gl_FragCoord.y = h + v + 0.5f;
+                    float dx = w + 0.5f - n.x0;
+                    float w_frag = 1.f / (riadok[v][0] + r[1] * dx);
+                    f.gl_FragCoord.z = (riadok[v][1] + r[4] * dx) * w_frag;
+                    rop.zapis = false;
+                    if (pokryte & (1u << l))
+                    {
+                        rop.idx = (h + v) * myframe.w + w;
+                        rop.hb = hb;
+                        rop.zapis = vsetky_prejdu || f.gl_FragCoord.z < myframe.hlbka[rop.idx];
+                        GPU_STAT(stat.fragmentsGenerated++; stat.fragmentsDepthKilled += !rop.zapis);
+                        if (rop.zapis || !early_z)
+                        {
+                            zive |= 1u << l;
+                        }
+                    }
+                    int k = 2;
+                    for (int p = 0; p < premenne_fs.size(); ++p)
+                    {
+                        Attribute& ciel = f.attributes[premenne_fs[p].atribut];
+                        for (uint32_t z = 0; z < premenne_fs[p].zlozky; z++, k++)
+                        {
+                            ciel.v4[z] = (riadok[v][k] + r[3 * k + 1] * dx) * w_frag;
+                        }
+                    }
+                }
+                if (zive == 0)
+                {
+                    continue;
+                }
+                if (prog->fs_batch == NULL)
+                {
+                    // bez davkoveho shaderu sa stiene len zive pixely, pomocne sa nepocitaju
+                    for (int l = 0; l < 4; l++)
+                    {
+                        if (!(zive & (1u << l)))
+                        {
+                            continue;
+                        }
+                        OutFragment& c = pamat.davka_vystup[prvy + l];
+                        c.gl_FragColor = glm::vec4(0, 0, 0, 0);
+                        GPU_STAT(stat_cas cas = statTeraz());
+                        prog->fs(c, pamat.davka_vstup[prvy + l], prog->premenne);
+                        GPU_STAT(stat.msFS += statMs(cas));
+                        vlakno_data::rop const& rop = pamat.davka_rop[prvy + l];
+                        if (rop.zapis)
+                        {
+                            writeFragment(rop.idx, rop.hb, pamat.davka_vstup[prvy + l].gl_FragCoord.z, c);
+                            GPU_STAT(stat.fragmentsWritten++; stat.msROP += statMs(cas));
+                        }
+                    }
+                    continue;
+                }
+                pamat.davka_pocet += 4;
+                if (pamat.davka_pocet == fragmentBatch)
+                {
+                    flushQuads(vlakno);
+                }
+            }
+            if (maska[0] | maska[1])
+            {
+                pamat.zapisane_bloky |= (uint64_t)1 << (((h - y0) / hizSize) * 8 + (blok - x0) / hizSize);
+            }
+        }
+    }
+    // fragmenty trojuholnika sa zapisu pred dalsim trojuholnikom dlazdice
+    flushQuads(vlakno);
+}
+
+/**
+ * @brief This function shades collected quads by batched fragment shader and writes visible fragments.
+ *
+ * @param vlakno index of the thread, selects fragment storage of the thread
+ */
+void            GPU::flushQuads            (uint32_t vlakno){
+    vlakno_data& pamat = pamat_vlakien[vlakno];
+    if (pamat.davka_pocet == 0)
+    {
+        return;
+    }
+    GPU_STAT(GPUStatistics& stat = pamat.statistiky);
+    program* prog = program_list[aktiv_prog];
+    for (uint32_t l = 0; l < pamat.davka_pocet; l++)
+    {
+        pamat.davka_vystup[l].gl_FragColor = glm::vec4(0, 0, 0, 0);
+    }
+    GPU_STAT(stat_cas cas = statTeraz());
+    prog->fs_batch(pamat.davka_vystup, pamat.davka_vstup, pamat.davka_pocet, prog->premenne);
+    GPU_STAT(stat.msFS += statMs(cas));
+    for (uint32_t l = 0; l < pamat.davka_pocet; l++)
+    {
+        vlakno_data::rop const& rop = pamat.davka_rop[l];
+        if (rop.zapis)
+        {
+            writeFragment(rop.idx, rop.hb, pamat.davka_vstup[l].gl_FragCoord.z, pamat.davka_vystup[l]);
+            GPU_STAT(stat.fragmentsWritten++);
+        }
+    }
+    GPU_STAT(stat.msROP += statMs(cas));
+    pamat.davka_pocet = 0;
+}
+
+/// @}
+
+/** \addtogroup command_tasks 06. Záznam a odesílání příkazů
+ * @{
+ */
+
+/**
+ * @brief This function removes all recorded commands.
+ */
+void     CommandBuffer::reset                 (){
+    prikazy.clear();
+    prve.clear();
+    pocty.clear();
+}
+
+/**
+ * @brief This function returns number of recorded commands.
+ *
+ * @return number of commands
+ */
+uint32_t CommandBuffer::size                  ()const{
+    return (uint32_t)prikazy.size();
+}
+
+/**
+ * @brief This function appends command to the buffer.
+ *
+ * @param druh type of command
+ * @param id program, vertex puller or first range of the command
+ * @param a uniform or number of ranges
+ *
+ * @return index of the command
+ */
+uint32_t CommandBuffer::record                (typ druh,uint32_t id,uint32_t a){
+    prikaz p;
+    p.druh = druh;
+    p.id = id;
+    p.a = a;
+    prikazy.push_back(p);
+    return (uint32_t)prikazy.size() - 1;
+}
+
+/**
+ * @brief This function records GPU::clear.
+ */
+void     CommandBuffer::clear                 (float r,float g,float b,float a){
+    record(typ::CLEAR, 0, 0);
+    prikazy.back().hodnota.v4 = glm::vec4(r, g, b, a);
+}
+
+/**
+ * @brief This function records GPU::clearColor.
+ */
+void     CommandBuffer::clearColor            (float r,float g,float b,float a){
+    record(typ::CLEAR_COLOR, 0, 0);
+    prikazy.back().hodnota.v4 = glm::vec4(r, g, b, a);
+}
+
+/**
+ * @brief This function records GPU::clearDepth.
+ */
+void     CommandBuffer::clearDepth            (float depth){
+    record(typ::CLEAR_DEPTH, 0, 0);
+    prikazy.back().hodnota.v1 = depth;
+}
+
+/**
+ * @brief This function records GPU::bindVertexPuller.
+ */
+void     CommandBuffer::bindVertexPuller      (VertexPullerID vao){
+    record(typ::BIND_VAO, (uint32_t)vao, 0);
+}
+
+/**
+ * @brief This function records GPU::unbindVertexPuller.
+ */
+void     CommandBuffer::unbindVertexPuller    (){
+    record(typ::UNBIND_VAO, 0, 0);
+}
+
+/**
+ * @brief This function records GPU::useProgram.
+ */
+void     CommandBuffer::useProgram            (ProgramID prg){
+    record(typ::USE_PROGRAM, (uint32_t)prg, 0);
+}
+
+/**
+ * @brief This function records GPU::programUniform1f.
+ *
+ * @return index of the command for patchUniform1f
+ */
+uint32_t CommandBuffer::programUniform1f      (ProgramID prg,uint32_t uniformId,float     const&d){
+    uint32_t i = record(typ::UNIFORM1F, (uint32_t)prg, uniformId);
+    prikazy[i].hodnota.v1 = d;
+    return i;
+}
+
+/**
+ * @brief This function records GPU::programUniform2f.
+ *
+ * @return index of the command for patchUniform2f
+ */
+uint32_t CommandBuffer::programUniform2f      (ProgramID prg,uint32_t uniformId,glm::vec2 const&d){
+    uint32_t i = record(typ::UNIFORM2F, (uint32_t)prg, uniformId);
+    prikazy[i].hodnota.v2 = d;
+    return i;
+}
+
+/**
+ * @brief This function records GPU::programUniform3f.
+ *
+ * @return index of the command for patchUniform3f
+ */
+uint32_t CommandBuffer::programUniform3f      (ProgramID prg,uint32_t uniformId,glm::vec3 const&d){
+    uint32_t i = record(typ::UNIFORM3F, (uint32_t)prg, uniformId);
+    prikazy[i].hodnota.v3 = d;
+    return i;
+}
+
+/**
+ * @brief This function records GPU::programUniform4f.
+ *
+ * @return index of the command for patchUniform4f
+ */
+uint32_t CommandBuffer::programUniform4f      (ProgramID prg,uint32_t uniformId,glm::vec4 const&d){
+    uint32_t i = record(typ::UNIFORM4F, (uint32_t)prg, uniformId);
+    prikazy[i].hodnota.v4 = d;
+    return i;
+}
+
+/**
+ * @brief This function records GPU::programUniformMatrix4f.
+ *
+ * @return index of the command for patchUniformMatrix4f
+ */
+uint32_t CommandBuffer::programUniformMatrix4f(ProgramID prg,uint32_t uniformId,glm::mat4 const&d){
+    uint32_t i = record(typ::UNIFORM_MATRIX4F, (uint32_t)prg, uniformId);
+    prikazy[i].hodnota.m4 = d;
+    return i;
+}
+
+/**
+ * @brief This function records GPU::drawTriangles.
+ */
+void     CommandBuffer::drawTriangles         (uint32_t  nofVertices){
+    drawTrianglesInstanced(nofVertices, 1);
+}
+
+/**
+ * @brief This function records GPU::drawTrianglesInstanced.
+ */
+void     CommandBuffer::drawTrianglesInstanced(uint32_t  nofVertices,uint32_t nofInstances){
+    uint32_t i = record(typ::DRAW, (uint32_t)prve.size(), 1);
+    prikazy[i].instancie = nofInstances;
+    prve.push_back(0);
+    pocty.push_back(nofVertices);
+}
+
+/**
+ * @brief This function records GPU::multiDraw, ranges are copied.
+ */
+void     CommandBuffer::multiDraw             (uint32_t const* first,uint32_t const* count,uint32_t drawCount){
+    record(typ::DRAW, (uint32_t)prve.size(), drawCount);
+    prve.insert(prve.end(), first, first + drawCount);
+    pocty.insert(pocty.end(), count, count + drawCount);
+}
+
+/**
+ * @brief This function records GPU::present.
+ */
+void     CommandBuffer::present               (){
+    record(typ::PRESENT, 0, 0);
+}
+
+/**
+ * @brief This function changes value of recorded uniform command (1 float).
+ *
+ * @param command index returned by programUniform1f
+ * @param d new value
+ */
+void     CommandBuffer::patchUniform1f        (uint32_t command,float     const&d){
+    prikazy[command].hodnota.v1 = d;
+}
+
+/**
+ * @brief This function changes value of recorded uniform command (2 floats).
+ *
+ * @param command index returned by programUniform2f
+ * @param d new value
+ */
+void     CommandBuffer::patchUniform2f        (uint32_t command,glm::vec2 const&d){
+    prikazy[command].hodnota.v2 = d;
+}
+
+/**
+ * @brief This function changes value of recorded uniform command (3 floats).
+ *
+ * @param command index returned by programUniform3f
+ * @param d new value
+ */
+void     CommandBuffer::patchUniform3f        (uint32_t command,glm::vec3 const&d){
+    prikazy[command].hodnota.v3 = d;
+}
+
+/**
+ * @brief This function changes value of recorded uniform command (4 floats).
+ *
+ * @param command index returned by programUniform4f
+ * @param d new value
+ */
+void     CommandBuffer::patchUniform4f        (uint32_t command,glm::vec4 const&d){
+    prikazy[command].hodnota.v4 = d;
+}
+
+/**
+ * @brief This function changes value of recorded uniform command (matrix 4x4).
+ *
+ * @param command index returned by programUniformMatrix4f
+ * @param d new value
+ */
+void     CommandBuffer::patchUniformMatrix4f  (uint32_t command,glm::mat4 const&d){
+    prikazy[command].hodnota.m4 = d;
+}
+
+/**
+ * @brief This function executes command buffer on the calling thread.
+ *
+ * Previous asynchronous submissions are finished first.
+ *
+ * @param commands recorded commands
+ */
+void            GPU::submit                (CommandBuffer const& commands){
+    finish();
+    executeCommands(commands);
+}
+
+/**
+ * @brief This function queues command buffer for execution on the submission thread.
+ *
+ * The buffer is copied, so it can be patched and submitted again immediately.
+ * Recording of the next command buffer touches no GPU state, so frame N+1 can be
+ * built while frame N is rasterized.
+ *
+ * Immediate calls that change or read state used by the commands wait until
+ * all submissions are finished: creation (when the object list grows) and deletion
+ * of buffers, vertex pullers, programs and uniform blocks, setBufferData, mapBuffer,
+ * vertex puller, program, uniform and uniform block setters, clears, draws,
+ * framebuffer creation, resizing and reading, and settings, counters and statistics.
+ * present is queued after pending submissions instead of waiting.
+ *
+ * Unsafe while a submission is pending (nothing can wait for them):
+ *  - writing through a pointer returned by mapBuffer or to memory of createBufferFromMemory,
+ *  - accessing pointers returned by getFramebufferColor or getFramebufferDepth.
+ *
+ * @param commands recorded commands
+ *
+ * @return fence that is signaled after the commands are executed
+ */
+FenceID         GPU::submitAsync           (CommandBuffer const& commands){
+    std::lock_guard<std::mutex> lock(fronta_zamok);
+    if (!odosielac.joinable())
+    {
+        odosielac = std::thread(&GPU::submitLoop, this);
+    }
+    fronta.push_back(commands);
+    odoslane++;
+    fronta_cv.notify_one();
+    return odoslane;
+}
+
+/**
+ * @brief This function tests if asynchronous submission is finished.
+ *
+ * @param fence fence returned by submitAsync
+ *
+ * @return true, if commands of the submission were executed
+ */
+bool            GPU::isFenceSignaled       (FenceID fence){
+    std::lock_guard<std::mutex> lock(fronta_zamok);
+    return dokoncene >= fence;
+}
+
+/**
+ * @brief This function waits until asynchronous submission is finished.
+ *
+ * @param fence fence returned by submitAsync
+ */
+void            GPU::waitFence             (FenceID fence){
+    std::unique_lock<std::mutex> lock(fronta_zamok);
+    fence_cv.wait(lock, [this, fence] { return dokoncene >= fence; });
+}
+
+/**
+ * @brief This function waits until all asynchronous submissions are finished.
+ *
+ * Immediate functions call it before they touch state used by submitted commands.
+ * On the submission thread it returns at once, earlier submissions are already
+ * executed there and the current one cannot wait for itself.
+ */
+void            GPU::finish                (){
+    if (std::this_thread::get_id() == odosielac.get_id())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(fronta_zamok);
+    FenceID posledny = odoslane;
+    fence_cv.wait(lock, [this, posledny] { return dokoncene >= posledny; });
+}
+
+/**
+ * @brief This function executes recorded commands by immediate GPU functions.
+ *
+ * @param commands recorded commands
+ */
+void            GPU::executeCommands       (CommandBuffer const& commands){
+    typedef CommandBuffer::typ typ;
+    for (CommandBuffer::prikaz const& p : commands.prikazy)
+    {
+        switch (p.druh)
+        {
+        case typ::CLEAR: clear(p.hodnota.v4.x, p.hodnota.v4.y, p.hodnota.v4.z, p.hodnota.v4.w); break;
+        case typ::CLEAR_COLOR: clearColor(p.hodnota.v4.x, p.hodnota.v4.y, p.hodnota.v4.z, p.hodnota.v4.w); break;
+        case typ::CLEAR_DEPTH: clearDepth(p.hodnota.v1); break;
+        case typ::BIND_VAO: bindVertexPuller(p.id); break;
+        case typ::UNBIND_VAO: unbindVertexPuller(); break;
+        case typ::USE_PROGRAM: useProgram(p.id); break;
+        case typ::UNIFORM1F: programUniform1f(p.id, p.a, p.hodnota.v1); break;
+        case typ::UNIFORM2F: programUniform2f(p.id, p.a, p.hodnota.v2); break;
+        case typ::UNIFORM3F: programUniform3f(p.id, p.a, p.hodnota.v3); break;
+        case typ::UNIFORM4F: programUniform4f(p.id, p.a, p.hodnota.v4); break;
+        case typ::UNIFORM_MATRIX4F: programUniformMatrix4f(p.id, p.a, p.hodnota.m4); break;
+        case typ::DRAW:
+            if (p.a > 0 && p.instancie > 0)
+            {
+                drawRanges(&commands.prve[p.id], &commands.pocty[p.id], p.a, p.instancie);
+            }
+            break;
+        case typ::PRESENT: presentFrame(); break;
+        }
+    }
+}
+
+/**
+ * @brief This function executes queued command buffers, it runs on the submission thread.
+ */
+void            GPU::submitLoop            (){
+    std::unique_lock<std::mutex> lock(fronta_zamok);
+    while (true)
+    {
+        fronta_cv.wait(lock, [this] { return fronta_koniec || !fronta.empty(); });
+        if (fronta.empty())
+        {
+            return;
+        }
+        CommandBuffer prikazy = std::move(fronta.front());
+        fronta.pop_front();
+        lock.unlock();
+        executeCommands(prikazy);
+        lock.lock();
+        dokoncene++;
+        fence_cv.notify_all();
+    }
+}
+
+/**
+ * @brief This function finishes queued submissions and joins the submission thread.
+ */
+void            GPU::stopSubmitThread      (){
+    {
+        std::lock_guard<std::mutex> lock(fronta_zamok);
+        fronta_koniec = true;
+    }
+    fronta_cv.notify_all();
+    if (odosielac.joinable())
+    {
+        odosielac.join();
+    }
+    fronta_koniec = false;
 }
 
 /// @}
@@ -8,7 +8,192 @@
 
 #include <student/fwd.hpp>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
 
+#ifndef GPU_STATISTICS
+/// nonzero value compiles counters and stage timers into drawTriangles
+#define GPU_STATISTICS 0
+#endif
+
+/**
+ * @brief Faces of triangles that are discarded before rasterization
+ */
+enum class CullFace{
+  NONE          ,
+  FRONT         ,
+  BACK          ,
+  FRONT_AND_BACK,
+};
+
+/**
+ * @brief Winding of front facing triangles
+ */
+enum class FrontFace{
+  CCW,
+  CW ,
+};
+
+/**
+ * @brief Counters and per-stage wall times of draw calls
+ *
+ * Values are collected only when gpu.cpp is compiled with GPU_STATISTICS=1,
+ * otherwise they stay zero. Times are in milliseconds, raster, FS and ROP
+ * times are summed over all rasterization threads.
+ */
+struct GPUStatistics{
+  uint64_t verticesShaded      = 0;///< vertices processed by vertex shader
+  uint64_t trianglesIn         = 0;///< assembled triangles
+  uint64_t trianglesClipped    = 0;///< clippings by near plane or guard band
+  uint64_t trianglesCulled     = 0;///< triangles outside frustum, back facing or without pixels
+  uint64_t fragmentsGenerated  = 0;///< covered pixels that were depth tested
+  uint64_t fragmentsDepthKilled= 0;///< fragments that failed depth test
+  uint64_t fragmentsWritten    = 0;///< fragments written to framebuffer
+  double   msPull              = 0;///< index read, vertex fetch and cache lookup
+  double   msVS                = 0;///< vertex shader
+  double   msClip              = 0;///< primitive assembly, frustum rejection and clipping
+  double   msSetup             = 0;///< perspective divide, face culling and binning
+  double   msRaster            = 0;///< coverage, depth and interpolation
+  double   msFS                = 0;///< fragment shader
+  double   msROP               = 0;///< depth and color writes
+};
+
+/**
+ * @brief Batched fragment shader
+ *
+ * Fragments come in 2x2 quads, nofFragments is a multiple of 4 and fragment
+ * 4 * q + l is the pixel (x + l % 2, y + l / 2) of quad q. Pixels of a quad that
+ * are not covered by the triangle are helpers, they are interpolated and shaded,
+ * but their output is discarded.
+ */
+using FragmentShaderBatch = void(*)(OutFragment*outFragments,InFragment const*inFragments,uint32_t nofFragments,Uniforms const&uniforms);
+
+/**
+ * @brief Uniform preamble of program
+ *
+ * It runs once per draw before vertices are processed. It derives values that are
+ * the same for all vertices (e.g. combined MVP matrix) and stores them in unused uniforms,
+ * so shaders read them instead of computing them per vertex or fragment.
+ */
+using UniformPreamble = void(*)(Uniforms&uniforms);
+
+/**
+ * @brief This function returns derivative of fragment attribute along x inside of a quad.
+ *
+ * @param inFragments fragments passed to FragmentShaderBatch
+ * @param i index of fragment
+ * @param attrib index of attribute
+ *
+ * @return difference of the attribute between right and left pixel of the top row of the quad
+ */
+inline glm::vec4 dFdx(InFragment const*inFragments,uint32_t i,uint32_t attrib){
+  InFragment const*quad = inFragments + (i & ~3u);
+  return quad[1].attributes[attrib].v4 - quad[0].attributes[attrib].v4;
+}
+
+/**
+ * @brief This function returns derivative of fragment attribute along y inside of a quad.
+ *
+ * @param inFragments fragments passed to FragmentShaderBatch
+ * @param i index of fragment
+ * @param attrib index of attribute
+ *
+ * @return difference of the attribute between upper and lower pixel of the left column of the quad
+ */
+inline glm::vec4 dFdy(InFragment const*inFragments,uint32_t i,uint32_t attrib){
+  InFragment const*quad = inFragments + (i & ~3u);
+  return quad[2].attributes[attrib].v4 - quad[0].attributes[attrib].v4;
+}
+
+/**
+ * @brief Identifier of uniform block, a set of uniforms shared by several programs
+ */
+using UniformBlockID = ObjectID;
+
+/**
+ * @brief Access flags of GPU::mapBuffer, they can be combined by |
+ */
+enum BufferAccess : uint32_t{
+  MAP_READ       = 1,///< mapped range is read
+  MAP_WRITE      = 2,///< mapped range is written
+  MAP_INVALIDATE = 4,///< previous content of mapped range is discarded
+};
+
+/**
+ * @brief Identifier of asynchronous submission, it is signaled when the submission is finished
+ */
+using FenceID = uint64_t;
+
+/**
+ * @brief This class records GPU commands that are executed later by GPU::submit or GPU::submitAsync
+ *
+ * Commands keep their order and arguments. Uniform commands return index of the command,
+ * so a recorded buffer can be replayed every frame with only its uniforms patched.
+ * Objects (programs, vertex pullers, buffers) are referenced by id and must exist when
+ * the buffer is executed.
+ */
+class CommandBuffer{
+  public:
+    void      reset                  ();
+    uint32_t  size                   ()const;
+
+    void      clear                  (float r,float g,float b,float a);
+    void      clearColor             (float r,float g,float b,float a);
+    void      clearDepth             (float depth);
+    void      bindVertexPuller       (VertexPullerID vao);
+    void      unbindVertexPuller     ();
+    void      useProgram             (ProgramID prg);
+    uint32_t  programUniform1f       (ProgramID prg,uint32_t uniformId,float     const&d);
+    uint32_t  programUniform2f       (ProgramID prg,uint32_t uniformId,glm::vec2 const&d);
+    uint32_t  programUniform3f       (ProgramID prg,uint32_t uniformId,glm::vec3 const&d);
+    uint32_t  programUniform4f       (ProgramID prg,uint32_t uniformId,glm::vec4 const&d);
+    uint32_t  programUniformMatrix4f (ProgramID prg,uint32_t uniformId,glm::mat4 const&d);
+    void      drawTriangles          (uint32_t  nofVertices);
+    void      drawTrianglesInstanced (uint32_t  nofVertices,uint32_t nofInstances);
+    void      multiDraw              (uint32_t const* first,uint32_t const* count,uint32_t drawCount);
+    void      present                ();
+
+    //patching of recorded uniform commands
+    void      patchUniform1f         (uint32_t command,float     const&d);
+    void      patchUniform2f         (uint32_t command,glm::vec2 const&d);
+    void      patchUniform3f         (uint32_t command,glm::vec3 const&d);
+    void      patchUniform4f         (uint32_t command,glm::vec4 const&d);
+    void      patchUniformMatrix4f   (uint32_t command,glm::mat4 const&d);
+
+    enum class typ{
+      CLEAR          ,
+      CLEAR_COLOR    ,
+      CLEAR_DEPTH    ,
+      BIND_VAO       ,
+      UNBIND_VAO     ,
+      USE_PROGRAM    ,
+      UNIFORM1F      ,
+      UNIFORM2F      ,
+      UNIFORM3F      ,
+      UNIFORM4F      ,
+      UNIFORM_MATRIX4F,
+      DRAW           ,
+      PRESENT        ,
+    };
+    struct prikaz
+    {
+        typ druh;
+        /// program, vertex puller alebo index prveho rozsahu
+        uint32_t id = 0;
+        /// uniform alebo pocet rozsahov
+        uint32_t a = 0;
+        uint32_t instancie = 1;
+        Attribute hodnota;
+    };
+    std::vector<prikaz> prikazy;
+    /// zaciatky a pocty vrcholov rozsahov kresliacich prikazov
+    std::vector<uint32_t> prve;
+    std::vector<uint32_t> pocty;
+    uint32_t record(typ druh,uint32_t id,uint32_t a);
+};
 
 /**
  * @brief This class represent software GPU
@@ -24,6 +209,10 @@ class GPU{
     void      setBufferData          (BufferID buffer,uint64_t offset,uint64_t size,void const* data);
     void      getBufferData          (BufferID buffer,uint64_t offset,uint64_t size,void      * data);
     bool      isBuffer               (BufferID buffer);
+    BufferID  createBufferFromMemory (void* data,uint64_t size);
+    void*     mapBuffer              (BufferID buffer,uint64_t offset,uint64_t size,uint32_t access);
+    void      unmapBuffer            (BufferID buffer);
+    bool      isBufferMapped         (BufferID buffer);
 
     //vertex array object commands (vertex puller)
     ObjectID  createVertexPuller     ();
@@ -40,6 +229,8 @@ class GPU{
     ProgramID createProgram          ();
     void      deleteProgram          (ProgramID prg);
     void      attachShaders          (ProgramID prg,VertexShader vs,FragmentShader fs);
+    void      attachFragmentShaderBatch(ProgramID prg,FragmentShaderBatch fs);
+    void      attachUniformPreamble  (ProgramID prg,UniformPreamble preamble);
     void      setVS2FSType           (ProgramID prg,uint32_t attrib,AttributeType type);
     void      useProgram             (ProgramID prg);
     bool      isProgram              (ProgramID prg);
@@ -49,6 +240,18 @@ class GPU{
     void      programUniform4f       (ProgramID prg,uint32_t uniformId,glm::vec4 const&d);
     void      programUniformMatrix4f (ProgramID prg,uint32_t uniformId,glm::mat4 const&d);
 
+    //uniform block commands
+    UniformBlockID createUniformBlock();
+    void      deleteUniformBlock     (UniformBlockID block);
+    bool      isUniformBlock         (UniformBlockID block);
+    void      uniformBlock1f         (UniformBlockID block,uint32_t uniformId,float     const&d);
+    void      uniformBlock2f         (UniformBlockID block,uint32_t uniformId,glm::vec2 const&d);
+    void      uniformBlock3f         (UniformBlockID block,uint32_t uniformId,glm::vec3 const&d);
+    void      uniformBlock4f         (UniformBlockID block,uint32_t uniformId,glm::vec4 const&d);
+    void      uniformBlockMatrix4f   (UniformBlockID block,uint32_t uniformId,glm::mat4 const&d);
+    void      bindUniformBlock       (ProgramID prg,UniformBlockID block,uint32_t firstUniform,uint32_t nofUniforms);
+    void      unbindUniformBlock     (ProgramID prg,UniformBlockID block);
+
     //framebuffer functions
     void      createFramebuffer      (uint32_t width,uint32_t height);
     void      deleteFramebuffer      ();
@@ -57,25 +260,128 @@ class GPU{
     float*    getFramebufferDepth    ();
     uint32_t  getFramebufferWidth    ();
     uint32_t  getFramebufferHeight   ();
+    void      setFramebufferCount    (uint32_t count);
+    uint32_t  getFramebufferCount    ();
+    FenceID   present                ();
+    uint8_t*  getPresentedColor      ();
+    float*    getPresentedDepth      ();
+    uint32_t  getPresentedWidth      ();
+    uint32_t  getPresentedHeight     ();
 
     //execution commands
     void      clear                  (float r,float g,float b,float a);
+    void      clearColor             (float r,float g,float b,float a);
+    void      clearDepth             (float depth);
+    void      setFastClear           (bool enable);
     void      drawTriangles          (uint32_t  nofVertices);
+    void      drawTrianglesInstanced (uint32_t  nofVertices,uint32_t nofInstances);
+    void      multiDraw              (uint32_t const* first,uint32_t const* count,uint32_t drawCount);
+    void      setInstanceUniform     (ProgramID prg,uint32_t uniformId);
+
+    //command buffers
+    void      submit                 (CommandBuffer const& commands);
+    FenceID   submitAsync            (CommandBuffer const& commands);
+    bool      isFenceSignaled        (FenceID fence);
+    void      waitFence              (FenceID fence);
+    void      finish                 ();
+
+    //parallel rasterization
+    void      setThreadCount         (uint32_t  nofThreads);
+    uint32_t  getThreadCount         ();
+
+    //post-transform vertex cache
+    void      setVertexCacheSize     (uint32_t  nofEntries);
+    uint64_t  getVertexCacheHits     ();
+    uint64_t  getVertexCacheMisses   ();
+    void      resetVertexCacheCounters();
+
+    //rasterization in 2x2 quads
+    void      setQuadShading         (bool enable);
+    bool      getQuadShading         ();
+
+    //streaming of large draw calls
+    void      setDrawBatchSize       (uint32_t  nofTriangles);
+    uint32_t  getDrawBatchSize       ();
+
+    //narrowing of 32 bit and 16 bit index buffers
+    void      setIndexNarrowing      (bool enable);
+    bool      getIndexNarrowing      ();
+
+    //early depth test and hierarchical depth rejection
+    void      setEarlyDepthTest      (bool enable);
+    bool      getEarlyDepthTest      ();
+
+    //face culling
+    void      setCullFace            (CullFace  mode);
+    void      setFrontFace           (FrontFace mode);
+
+    //statistics, collected only with GPU_STATISTICS
+    GPUStatistics const& getStatistics();
+    void      resetStatistics        ();
 
     /// \addtogroup gpu_init 00. proměnné, inicializace / deinicializace grafické karty
     /// @{
     /// \todo zde si můžete vytvořit proměnné grafické karty (buffery, programy, ...)
     std::vector<void*> buffer_list;
     std::vector<BufferID> buf_id;
+
+    /// arena bufferov, data kazdeho bufferu su zarovnane na bufferAlignment bajtov
+    static const uint64_t bufferAlignment = 64;
+    /// triedy velkosti 2^minTrieda .. 2^maxTrieda bajtov sa delia zo slabov
+    static const uint32_t minTrieda = 6;
+    static const uint32_t maxTrieda = 16;
+    static const uint64_t velkostSlabu = 256 * 1024;
+    /// limit volnych velkych blokov drzanych pre dalsie buffery
+    static const uint64_t maxVolnychVelkych = 64 * 1024 * 1024;
+    struct blok
+    {
+        void* data = NULL;
+        /// ukazovatel od systemu pre velke bloky, NULL pre bloky zo slabu
+        void* surovy = NULL;
+        uint64_t kapacita = 0;
+        /// velkost pozadovana pri vytvoreni bufferu
+        uint64_t velkost = 0;
+        uint32_t trieda = 0;
+        /// pamat volajuceho z createBufferFromMemory, arena ju neuvolnuje
+        bool externy = false;
+        bool mapovany = false;
+        /// niektora tabulka si z bufferu odvodila uzke indexy, zmena ich musi zahodit
+        bool zuzeny = false;
+    };
+    std::vector<blok> buf_bloky;
+    std::vector<void*> volne_bloky[maxTrieda - minTrieda + 1];
+    std::vector<void*> slaby;
+    std::vector<blok> volne_velke;
+    uint64_t volne_velke_bajty = 0;
+    static void* allocAligned(uint64_t size,void*& surovy);
+    blok allocBlock(uint64_t size);
+    BufferID storeBuffer(blok const& b);
+    void freeBlock (blok const& b);
     struct frame
     {
         std::vector<float> hlbka;
         std::vector<uint8_t> color;
-        int h;
-        int w;
-        
+        int h = 0;
+        int w = 0;
+
+        /// coarse depth buffer, minimum and maximum depth of every hizSize x hizSize block
+        std::vector<float> hiz_min;
+        std::vector<float> hiz_max;
+        int hiz_w = 0;
+        int hiz_h = 0;
+        bool hiz_platny = false;
+
+        /// tiles whose clear was deferred, bit 1 = color, bit 2 = depth
+        std::vector<uint8_t> zmazat;
+        uint32_t zmazat_farba = 0;
+        float zmazat_hlbka = 1.1f;
     };
     frame myframe;
+    /// prezentovane snimky, myframe sa pri present vymeni s najstarsim z nich
+    std::vector<frame> prezentovane;
+    int posledny_prezent = -1;
+    void presentFrame();
+    frame* presentedFrame();
 
     struct hlava
     {
@@ -92,11 +398,27 @@ class GPU{
         BufferID buffer;
     };
 
+    /// one read of the fetch plan, zaciatok is resolved at the start of every draw
+    struct citanie
+    {
+        char const* zaciatok;
+        uint64_t stride;
+        uint32_t atribut;
+        uint32_t velkost;
+    };
+
     struct tabulka
     {
         hlava hlavy[maxAttributes];
         _index index;
         bool ind = false;
+        citanie plan[maxAttributes];
+        uint32_t plan_pocet = 0;
+        bool plan_platny = false;
+        /// zuzena kopia indexov pri setIndexNarrowing, prazdna ak sa zuzit nedaju
+        std::vector<uint8_t> uzke_indexy;
+        IndexType uzky_typ = IndexType::UINT32;
+        bool uzke_platne = false;
     };
     std::vector<tabulka*> vertex_list;
     std::vector<ObjectID> ver_id;
@@ -106,7 +428,19 @@ class GPU{
     {
         VertexShader vs;
         FragmentShader fs;
+        FragmentShaderBatch fs_batch = NULL;
+        UniformPreamble preambula = NULL;
+        /// uniform that receives index of instance, maxUniforms = none
+        uint32_t instance_uniform = maxUniforms;
         Uniforms premenne;
+        /// uniform blok sa pred kazdym kreslenim skopiruje do premenne.uniform[prvy .. prvy + pocet)
+        struct vazba
+        {
+            UniformBlockID blok;
+            uint32_t prvy;
+            uint32_t pocet;
+        };
+        std::vector<vazba> vazby;
         std::vector<int> type;
         std::vector<int>  atr_num;
         
@@ -114,21 +448,190 @@ class GPU{
     };
     std::vector<int> clip_bod;
     std::vector<int> non_clip_bod;
-    uint8_t poradie1;
-    uint16_t poradie2;
-    uint32_t poradie3;
-    int ten_type;
+    char const* index_data = NULL;
+    IndexType index_type;
+    /// indexy aktualnej davky prevedene na uint32_t
+    std::vector<uint32_t> indexy;
+    void readIndices      (uint32_t zaciatok,uint32_t koniec);
+    bool index_narrowing = false;
+    void narrowIndices    (tabulka& t);
+    void invalidateIndexCopies(BufferID buffer);
+    void prepareVertexFetch();
+    void fetchVertex       (InVertex& vrchol);
     std::vector<program*> program_list;
     std::vector<ProgramID> pro_id;
+    std::vector<Uniforms*> uniform_bloky;
+    std::vector<UniformBlockID> ubo_id;
+    void applyUniformBlocks(program* prog);
     ProgramID aktiv_prog;
 
+    /// varying declared by setVS2FSType, only these are kept after vertex shader
+    struct premenna_fs
+    {
+        uint32_t atribut;
+        uint32_t zlozky;
+    };
+    std::vector<premenna_fs> premenne_fs;
+    /// number of floats of all varyings of one vertex
+    uint32_t zlozky_fs = 0;
+    /// vertices after vertex shader and clipping, positions and packed varyings are separate arrays
+    std::vector<glm::vec4> vrch_pozicie;
+    std::vector<float> vrch_premenne;
+    void prepareVaryings();
+    uint32_t storeVertex(OutVertex const& vrchol);
+    uint32_t lerpVertex (uint32_t a,uint32_t b,float t);
+
+    /// triangle is a triple of indices into vrch_pozicie / vrch_premenne
     struct trojuhol
     {
-        OutVertex body[3];
+        uint32_t vrchol[3];
     };
-    InFragment* f;
-    OutFragment* c;
+    std::vector<trojuhol> trojuholnik;
+
+    /// number of fragments (whole quads) passed to one call of batched fragment shader
+    static const uint32_t fragmentBatch = 16;
+    bool quad_shading = false;
+
+    /// fragment storage of one rasterization thread, it is reused for every fragment
+    struct vlakno_data
+    {
+        InFragment fragment;
+        OutFragment vystup;
+        /// blocks of the current tile whose depth was written, bit = by * 8 + bx
+        uint64_t zapisane_bloky = 0;
+        /// statistics of this thread, merged into statistiky after each draw
+        GPUStatistics statistiky;
+        /// quads waiting for batched fragment shader and where their fragments are written
+        struct rop
+        {
+            int idx;
+            int hb;
+            bool zapis;
+        };
+        InFragment davka_vstup[fragmentBatch];
+        OutFragment davka_vystup[fragmentBatch];
+        rop davka_rop[fragmentBatch];
+        uint32_t davka_pocet = 0;
+    };
+    std::vector<vlakno_data> pamat_vlakien;
+
+    /// post-transform vertex cache, tag is gl_VertexID of cached vertex, value is index of stored vertex
+    static const uint64_t prazdny_tag = ~(uint64_t)0;
+    std::vector<uint64_t> cache_tag;
+    std::vector<uint32_t> cache_vrcholy;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
     InVertex* akt_ver;
+
+    /// statistics accumulated since the last resetStatistics
+    GPUStatistics statistiky;
+
+    /// size of screen tile (in pixels) used for binning of triangles
+    static const int tileSize = 64;
+    /// size of block of coarse depth buffer, tile contains (tileSize/hizSize)^2 = 64 blocks
+    static const int hizSize = 8;
+    bool early_z = true;
+    /// clears only tag tiles, tiles are cleared physically when they are drawn to or read
+    bool fast_clear = false;
+    static const uint8_t zmazatFarbu = 1;
+    static const uint8_t zmazatHlbku = 2;
+    CullFace cull_face = CullFace::NONE;
+    FrontFace front_face = FrontFace::CCW;
+    bool isCulled       (trojuhol const& troj);
+
+    /// guard band in pixels around the framebuffer, triangles are clipped only when they reach beyond it
+    static const int guardBand = 4096;
+    float frustum_vpravo = 1.f;
+    float frustum_hore = 1.f;
+    float guard_vlavo = -1.f;
+    float guard_vpravo = 1.f;
+    float guard_dole = -1.f;
+    float guard_hore = 1.f;
+    void setupFrustumPlanes();
+    bool isOutsideFrustum  (trojuhol const& troj);
+    void emitTriangle      (trojuhol const& troj);
+    void resizeHiZ      ();
+    void rebuildHiZ     ();
+    void updateHiZ      (int x0,int y0,uint64_t bloky);
+    void resolveTileClear(uint32_t tile,uint8_t co);
+    void resolveClear   (uint8_t co);
+    std::vector<std::vector<uint32_t>> dlazdice;
+    int dlazdiceX = 0;
+    int dlazdiceY = 0;
+    /// edge function prepared for one row: value in pixel w is (w + 0.5 - ax) * dy - riadok
+    struct hrana_riadku
+    {
+        float ax;
+        float dy;
+        float riadok;
+    };
+    /// evaluates three edges in 8 pixels of a row starting at column w, returns coverage mask
+    typedef uint32_t (*pokrytie8)(hrana_riadku const* e,int w,float* hodnoty);
+    pokrytie8 pokrytie;
+    /// triangle data computed once by setupTriangle and shared by all tiles of the triangle
+    struct nastavenie
+    {
+        /// oriented edges, value in pixel center (px,py) is (px - ax) * dy - (py - ay) * dx
+        struct
+        {
+            float ax, ay, dx, dy;
+        } e[3];
+        /// bounding box of pixel centers clipped to framebuffer, hk and wk are exclusive
+        int hz, hk, wz, wk;
+        /// coarse depth test is valid, depth range of the triangle with a margin
+        bool hiz;
+        float z_odmietni;
+        float z_prijmi;
+        /// origin of interpolation planes (first vertex)
+        float x0, y0;
+    };
+    std::vector<nastavenie> nastavenia;
+    /// planes (q0, dq/dx, dq/dy) of 1/w, z/w and varyings/w, rovin_na_troj planes per triangle
+    std::vector<float> roviny;
+    uint32_t rovin_na_troj = 0;
+    /// number of triangles processed by one batch of drawTriangles, 0 = whole draw call
+    uint32_t velkost_davky = 4096;
+    void drawRanges       (uint32_t const* first,uint32_t const* count,uint32_t drawCount,uint32_t nofInstances);
+    void beginBatch       ();
+    void pullVertices     (uint32_t zaciatok,uint32_t koniec);
+    void finishBatch      ();
+    bool setupTriangle    (uint32_t i);
+    void rasterizeTile    (uint32_t tile,uint32_t vlakno);
+    bool clipTriangleToTile(nastavenie const& n,int& hz,int& hk,int& wz,int& wk);
+    void writeFragment    (int idx,int hb,float z,OutFragment const& vystup);
+    void rasterizeTriangle(uint32_t i,int x0,int y0,int x1,int y1,uint32_t vlakno);
+    void rasterizeTriangleQuads(uint32_t i,int x0,int y0,int x1,int y1,uint32_t vlakno);
+    void flushQuads       (uint32_t vlakno);
+
+    /// worker pool, thread 0 is always the calling thread
+    typedef void (GPU::*uloha)(uint32_t,uint32_t);
+    std::vector<std::thread> vlakna;
+    std::mutex zamok;
+    std::condition_variable start_cv;
+    std::condition_variable koniec_cv;
+    uint64_t generacia = 0;
+    uint32_t aktivne = 0;
+    bool ukoncit = false;
+    uloha akt_uloha = nullptr;
+    uint32_t pocet_uloh = 0;
+    std::atomic<uint32_t> dalsia_uloha;
+    void runParallel(uloha fn,uint32_t count);
+    void processTasks(uint32_t vlakno);
+    void workerLoop  (uint32_t vlakno,uint64_t videna);
+    void stopWorkers ();
+
+    /// odosielacie vlakno pre submitAsync, bezi len ked bolo nieco odoslane
+    void executeCommands(CommandBuffer const& commands);
+    void submitLoop      ();
+    void stopSubmitThread();
+    std::thread odosielac;
+    std::mutex fronta_zamok;
+    std::condition_variable fronta_cv;
+    std::condition_variable fence_cv;
+    std::deque<CommandBuffer> fronta;
+    FenceID odoslane = 0;
+    FenceID dokoncene = 0;
+    bool fronta_koniec = false;
     /// @}
 };
 
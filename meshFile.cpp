@@ -0,0 +1,234 @@
+/*!
+ * @file
+ * @brief This file contains implementation of binary mesh format and its memory mapped loader
+ */
+
+#include <student/meshFile.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace{
+
+uint64_t alignUp(uint64_t value){
+  return (value+meshFileAlignment-1)/meshFileAlignment*meshFileAlignment;
+}
+
+/**
+ * @brief This function maps whole file copy on write, so buffers over it can be written.
+ *
+ * @param fileName name of file
+ * @param size returns size of file
+ *
+ * @return pointer to mapped file, nullptr on error
+ */
+void*mapFile(char const*fileName,uint64_t&size){
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(fileName,GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,nullptr);
+  if(file == INVALID_HANDLE_VALUE)return nullptr;
+  LARGE_INTEGER fileSize;
+  if(!GetFileSizeEx(file,&fileSize) || fileSize.QuadPart == 0){
+    CloseHandle(file);
+    return nullptr;
+  }
+  HANDLE mapping = CreateFileMappingA(file,nullptr,PAGE_WRITECOPY,0,0,nullptr);
+  void*data = mapping?MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0):nullptr;
+  //the view keeps the file mapped after the handles are closed
+  if(mapping)CloseHandle(mapping);
+  CloseHandle(file);
+  size = (uint64_t)fileSize.QuadPart;
+  return data;
+#else
+  int fd = open(fileName,O_RDONLY);
+  if(fd < 0)return nullptr;
+  struct stat st;
+  if(fstat(fd,&st) != 0 || st.st_size == 0){
+    close(fd);
+    return nullptr;
+  }
+  void*data = mmap(nullptr,(size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(data == MAP_FAILED)return nullptr;
+  size = (uint64_t)st.st_size;
+  return data;
+#endif
+}
+
+void unmapFile(void*data,uint64_t size){
+#if defined(_WIN32)
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap(data,(size_t)size);
+#endif
+}
+
+/**
+ * @brief This function checks that all indices address vertices of the mesh.
+ *
+ * @param h valid header
+ * @param data mapped file
+ *
+ * @return true if every index is smaller than nofVertices
+ */
+bool hasValidIndices(MeshFileHeader const&h,char const*data){
+  char const*indices = data+h.indexOffset;
+  uint32_t maximum = 0;
+  if(h.indexSize == 2){
+    for(uint32_t i=0;i<h.nofIndices;++i){
+      uint16_t index;
+      std::memcpy(&index,indices+2*(size_t)i,sizeof(index));
+      maximum = std::max<uint32_t>(maximum,index);
+    }
+  }else{
+    for(uint32_t i=0;i<h.nofIndices;++i){
+      uint32_t index;
+      std::memcpy(&index,indices+4*(size_t)i,sizeof(index));
+      maximum = std::max(maximum,index);
+    }
+  }
+  return h.nofIndices == 0 || maximum < h.nofVertices;
+}
+
+/**
+ * @brief This function checks that header describes data inside of file.
+ */
+bool isValid(MeshFileHeader const&h,uint64_t fileSize){
+  if(fileSize < sizeof(MeshFileHeader))return false;
+  if(std::memcmp(h.magic,meshFileMagic,4) != 0 || h.version != meshFileVersion)return false;
+  if(h.nofVertices == 0 || h.vertexStride == 0)return false;
+  if(h.vertexOffset%meshFileAlignment || h.indexOffset%meshFileAlignment)return false;
+  if(h.vertexOffset > fileSize || (uint64_t)h.nofVertices*h.vertexStride > fileSize-h.vertexOffset)return false;
+  if(h.nofIndices){
+    if(h.indexSize != 2 && h.indexSize != 4)return false;
+    if(h.indexOffset > fileSize || (uint64_t)h.nofIndices*h.indexSize > fileSize-h.indexOffset)return false;
+  }
+  for(uint32_t i=0;i<maxAttributes;++i){
+    MeshFileAttribute const&a = h.attributes[i];
+    if(a.type > (uint32_t)AttributeType::VEC4)return false;
+    if(a.type != 0 && (uint64_t)a.offset+a.type*sizeof(float) > h.vertexStride)return false;
+  }
+  return true;
+}
+
+}
+
+/**
+ * @brief This function writes mesh file.
+ *
+ * @param fileName name of file
+ * @param vertices interleaved vertices
+ * @param nofVertices number of vertices
+ * @param vertexStride size of vertex in bytes
+ * @param attributes attributes of vertex, attribute i is read by head i
+ * @param nofAttributes number of attributes (at most maxAttributes)
+ * @param indices indices, nullptr for non indexed mesh
+ * @param nofIndices number of indices
+ * @param indexSize size of index in bytes, 2 or 4
+ *
+ * @return true on success
+ */
+bool saveMesh(char const*fileName,void const*vertices,uint32_t nofVertices,uint32_t vertexStride,
+              MeshFileAttribute const*attributes,uint32_t nofAttributes,
+              void const*indices,uint32_t nofIndices,uint32_t indexSize){
+  if(nofAttributes > maxAttributes)return false;
+  MeshFileHeader h;
+  std::memset(&h,0,sizeof(h));
+  std::memcpy(h.magic,meshFileMagic,4);
+  h.version      = meshFileVersion;
+  h.nofVertices  = nofVertices;
+  h.nofIndices   = indices?nofIndices:0;
+  h.vertexStride = vertexStride;
+  h.indexSize    = h.nofIndices?indexSize:0;
+  h.vertexOffset = alignUp(sizeof(MeshFileHeader));
+  h.indexOffset  = h.nofIndices?alignUp(h.vertexOffset+(uint64_t)nofVertices*vertexStride):0;
+  for(uint32_t i=0;i<nofAttributes;++i)h.attributes[i] = attributes[i];
+  if(!isValid(h,(h.nofIndices?h.indexOffset+(uint64_t)nofIndices*indexSize:h.vertexOffset+(uint64_t)nofVertices*vertexStride)))return false;
+
+  std::FILE*f = std::fopen(fileName,"wb");
+  if(!f)return false;
+  std::vector<char>padding(meshFileAlignment,0);
+  bool ok = std::fwrite(&h,sizeof(h),1,f) == 1;
+  ok = ok && std::fwrite(padding.data(),1,h.vertexOffset-sizeof(h),f) == h.vertexOffset-sizeof(h);
+  ok = ok && std::fwrite(vertices,vertexStride,nofVertices,f) == nofVertices;
+  if(h.nofIndices){
+    uint64_t end = h.vertexOffset+(uint64_t)nofVertices*vertexStride;
+    ok = ok && std::fwrite(padding.data(),1,h.indexOffset-end,f) == h.indexOffset-end;
+    ok = ok && std::fwrite(indices,indexSize,nofIndices,f) == nofIndices;
+  }
+  return std::fclose(f) == 0 && ok;
+}
+
+/**
+ * @brief This function loads mesh file.
+ *
+ * The file is memory mapped and GPU buffers are created over the mapping without copying,
+ * vertex puller has indexing and one enabled head per attribute of the file.
+ *
+ * @param gpu GPU
+ * @param mesh returns buffers and vertex puller of the mesh
+ * @param fileName name of file
+ *
+ * @return true on success, false if file cannot be mapped, it is not a valid mesh file
+ * or some index is not smaller than number of vertices
+ */
+bool loadMesh(GPU&gpu,Mesh&mesh,char const*fileName){
+  uint64_t size = 0;
+  void*data = mapFile(fileName,size);
+  if(!data)return false;
+  MeshFileHeader h;
+  if(size >= sizeof(h))std::memcpy(&h,data,sizeof(h));
+  //an index outside of vertex block would make vertex puller read outside of mapping
+  if(!isValid(h,size) || !hasValidIndices(h,static_cast<char const*>(data))){
+    unmapFile(data,size);
+    return false;
+  }
+  char*bytes = static_cast<char*>(data);
+  mesh.mapping     = data;
+  mesh.mappingSize = size;
+  mesh.nofVertices = h.nofVertices;
+  mesh.nofIndices  = h.nofIndices;
+  mesh.vertices    = gpu.createBufferFromMemory(bytes+h.vertexOffset,(uint64_t)h.nofVertices*h.vertexStride);
+  mesh.indices     = emptyID;
+  mesh.vao         = gpu.createVertexPuller();
+  if(h.nofIndices){
+    mesh.indices = gpu.createBufferFromMemory(bytes+h.indexOffset,(uint64_t)h.nofIndices*h.indexSize);
+    gpu.setVertexPullerIndexing(mesh.vao,h.indexSize == 2?IndexType::UINT16:IndexType::UINT32,mesh.indices);
+  }
+  for(uint32_t i=0;i<maxAttributes;++i){
+    MeshFileAttribute const&a = h.attributes[i];
+    if(a.type == 0)continue;
+    gpu.setVertexPullerHead(mesh.vao,i,(AttributeType)a.type,h.vertexStride,a.offset,mesh.vertices);
+    gpu.enableVertexPullerHead(mesh.vao,i);
+  }
+  return true;
+}
+
+/**
+ * @brief This function deletes buffers and vertex puller of mesh and unmaps its file.
+ *
+ * @param gpu GPU that was used by loadMesh
+ * @param mesh loaded mesh
+ */
+void deleteMesh(GPU&gpu,Mesh&mesh){
+  if(!mesh.mapping)return;
+  gpu.finish();
+  gpu.deleteVertexPuller(mesh.vao);
+  if(mesh.indices != emptyID)gpu.deleteBuffer(mesh.indices);
+  gpu.deleteBuffer(mesh.vertices);
+  unmapFile(mesh.mapping,mesh.mappingSize);
+  mesh = Mesh();
+}
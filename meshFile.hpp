@@ -0,0 +1,72 @@
+/*!
+ * @file
+ * @brief This file contains binary mesh format and its memory mapped loader
+ *
+ * File layout (little endian):
+ *  - MeshFileHeader
+ *  - interleaved vertices at vertexOffset, nofVertices * vertexStride bytes
+ *  - indices at indexOffset, nofIndices * indexSize bytes (16 or 32 bit)
+ *
+ * Both data blocks start at multiples of meshFileAlignment, so buffers created
+ * over the mapped file keep the alignment of GPU buffers.
+ */
+
+#pragma once
+
+#include <student/gpu.hpp>
+
+/// first 4 bytes of every mesh file
+char const     meshFileMagic[5]  = "IZGM";
+/// version written by saveMesh
+uint32_t const meshFileVersion   = 1;
+/// alignment of vertex and index blocks inside of file
+uint64_t const meshFileAlignment = 64;
+
+/**
+ * @brief Attribute of vertex inside of mesh file, it is read by vertex puller head with the same index
+ */
+struct MeshFileAttribute{
+  uint32_t type  ;///< AttributeType, EMPTY = head is disabled
+  uint32_t offset;///< offset of attribute inside of vertex in bytes
+};
+
+/**
+ * @brief Header at the beginning of mesh file
+ */
+struct MeshFileHeader{
+  char              magic[4]    ;///< meshFileMagic
+  uint32_t          version     ;///< meshFileVersion
+  uint32_t          nofVertices ;///< number of vertices
+  uint32_t          nofIndices  ;///< number of indices, 0 = non indexed mesh
+  uint32_t          vertexStride;///< size of one vertex in bytes
+  uint32_t          indexSize   ;///< size of index in bytes, 2 or 4 (0 for non indexed mesh)
+  uint64_t          vertexOffset;///< position of vertices from the beginning of file
+  uint64_t          indexOffset ;///< position of indices from the beginning of file
+  MeshFileAttribute attributes[maxAttributes];
+};
+
+/**
+ * @brief Mesh loaded by loadMesh
+ *
+ * Buffers use the mapped file in place, so the mapping lives until deleteMesh.
+ */
+struct Mesh{
+  BufferID       vertices    = emptyID;///< vertex buffer
+  BufferID       indices     = emptyID;///< index buffer, emptyID for non indexed mesh
+  VertexPullerID vao         = emptyID;///< vertex puller with enabled heads of all attributes
+  uint32_t       nofVertices = 0      ;///< number of vertices
+  uint32_t       nofIndices  = 0      ;///< number of indices
+  void*          mapping     = nullptr;///< mapped file
+  uint64_t       mappingSize = 0      ;///< size of mapped file
+
+  /**
+   * @brief This function returns number of vertices that should be passed to drawTriangles.
+   */
+  uint32_t drawCount()const{return nofIndices?nofIndices:nofVertices;}
+};
+
+bool saveMesh  (char const*fileName,void const*vertices,uint32_t nofVertices,uint32_t vertexStride,
+                MeshFileAttribute const*attributes,uint32_t nofAttributes,
+                void const*indices,uint32_t nofIndices,uint32_t indexSize);
+bool loadMesh  (GPU&gpu,Mesh&mesh,char const*fileName);
+void deleteMesh(GPU&gpu,Mesh&mesh);
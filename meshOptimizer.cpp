@@ -0,0 +1,182 @@
+/*!
+ * @file
+ * @brief This file contains implementation of index and vertex buffer preparation
+ */
+
+#include <student/meshOptimizer.hpp>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief This function returns the narrowest index type that can address all vertices.
+ *
+ * @param nofVertices number of vertices
+ *
+ * @return UINT8, UINT16 or UINT32
+ */
+IndexType selectIndexType(uint32_t nofVertices){
+  if(nofVertices <= 0x100  )return IndexType::UINT8 ;
+  if(nofVertices <= 0x10000)return IndexType::UINT16;
+  return IndexType::UINT32;
+}
+
+/**
+ * @brief This function converts indices to narrower type.
+ *
+ * @param output nofIndices * (uint32_t)type bytes
+ * @param indices 32 bit indices, all of them must fit into type
+ * @param nofIndices number of indices
+ * @param type index type of output
+ */
+void narrowIndices(void*output,uint32_t const*indices,uint32_t nofIndices,IndexType type){
+  if(type == IndexType::UINT8){
+    uint8_t*o = static_cast<uint8_t*>(output);
+    for(uint32_t i=0;i<nofIndices;++i)o[i] = (uint8_t)indices[i];
+  }else if(type == IndexType::UINT16){
+    uint16_t*o = static_cast<uint16_t*>(output);
+    for(uint32_t i=0;i<nofIndices;++i)o[i] = (uint16_t)indices[i];
+  }else{
+    std::memcpy(output,indices,sizeof(uint32_t)*nofIndices);
+  }
+}
+
+/**
+ * @brief This function reorders triangles for a post transform vertex cache (Tipsify).
+ *
+ * The algorithm fans around vertices and prefers the next fanning vertex that is still in a FIFO
+ * cache of cacheSize entries, see Sander, Nehab, Barczak: Fast Triangle Reordering
+ * for Vertex Locality and Reduced Overdraw, 2007. It runs in linear time.
+ *
+ * @param indices triangle list, it is reordered in place
+ * @param nofIndices number of indices, multiple of 3
+ * @param nofVertices number of vertices, all indices are smaller
+ * @param cacheSize size of simulated cache, about 16 works well
+ */
+void optimizeVertexCache(uint32_t*indices,uint32_t nofIndices,uint32_t nofVertices,uint32_t cacheSize){
+  uint32_t const nofTriangles = nofIndices/3;
+  if(nofTriangles == 0)return;
+
+  //triangles of every vertex
+  std::vector<uint32_t>live(nofVertices,0);
+  for(uint32_t i=0;i<nofTriangles*3;++i)live[indices[i]]++;
+  std::vector<uint32_t>offsets(nofVertices+1,0);
+  for(uint32_t v=0;v<nofVertices;++v)offsets[v+1] = offsets[v]+live[v];
+  std::vector<uint32_t>adjacency(offsets[nofVertices]);
+  std::vector<uint32_t>fill(offsets.begin(),offsets.end()-1);
+  for(uint32_t t=0;t<nofTriangles;++t)
+    for(uint32_t k=0;k<3;++k)adjacency[fill[indices[3*t+k]]++] = t;
+
+  std::vector<uint32_t>time     (nofVertices,0);
+  std::vector<bool    >emitted  (nofTriangles,false);
+  std::vector<uint32_t>deadEnd  ;
+  std::vector<uint32_t>candidates;
+  std::vector<uint32_t>output   ;
+  output.reserve(nofTriangles*3);
+  uint32_t timeStamp = cacheSize+1;
+  uint32_t cursor    = 0;
+  int64_t  fanning   = 0;
+
+  while(fanning >= 0){
+    candidates.clear();
+    uint32_t f = (uint32_t)fanning;
+    for(uint32_t a=offsets[f];a<offsets[f+1];++a){
+      uint32_t t = adjacency[a];
+      if(emitted[t])continue;
+      for(uint32_t k=0;k<3;++k){
+        uint32_t v = indices[3*t+k];
+        output.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if(timeStamp-time[v] > cacheSize)time[v] = timeStamp++;
+      }
+      emitted[t] = true;
+    }
+
+    //next fanning vertex is the oldest one still in cache with live triangles
+    fanning = -1;
+    int64_t best = -1;
+    for(uint32_t v:candidates){
+      if(live[v] == 0)continue;
+      int64_t priority = 0;
+      if(timeStamp-time[v]+2*live[v] <= cacheSize)priority = timeStamp-time[v];
+      if(priority > best){
+        best    = priority;
+        fanning = v;
+      }
+    }
+    if(fanning >= 0)continue;
+
+    //dead end, recently used vertex or the next vertex in input order
+    while(!deadEnd.empty()){
+      uint32_t v = deadEnd.back();
+      deadEnd.pop_back();
+      if(live[v] > 0){
+        fanning = v;
+        break;
+      }
+    }
+    while(fanning < 0 && cursor < nofVertices){
+      if(live[cursor] > 0)fanning = cursor;
+      cursor++;
+    }
+  }
+  std::memcpy(indices,output.data(),sizeof(uint32_t)*output.size());
+}
+
+/**
+ * @brief This function reorders vertices in order of their first use and drops unused vertices.
+ *
+ * Vertex puller then reads vertex buffer mostly forward and consecutive indices
+ * map to different entries of the direct mapped vertex cache of GPU.
+ *
+ * @param vertices interleaved vertices, they are reordered in place
+ * @param nofVertices number of vertices
+ * @param vertexStride size of vertex in bytes
+ * @param indices indices, they are remapped in place
+ * @param nofIndices number of indices
+ *
+ * @return number of used vertices, they are at the beginning of vertices
+ */
+uint32_t optimizeVertexFetch(void*vertices,uint32_t nofVertices,uint32_t vertexStride,uint32_t*indices,uint32_t nofIndices){
+  uint32_t const unused = 0xffffffffu;
+  std::vector<uint32_t>remap(nofVertices,unused);
+  std::vector<char>reordered((size_t)nofVertices*vertexStride);
+  char const*source = static_cast<char const*>(vertices);
+  uint32_t used = 0;
+  for(uint32_t i=0;i<nofIndices;++i){
+    uint32_t&r = remap[indices[i]];
+    if(r == unused){
+      std::memcpy(&reordered[(size_t)used*vertexStride],source+(size_t)indices[i]*vertexStride,vertexStride);
+      r = used++;
+    }
+    indices[i] = r;
+  }
+  std::memcpy(vertices,reordered.data(),(size_t)used*vertexStride);
+  return used;
+}
+
+/**
+ * @brief This function returns average number of vertex shader invocations per triangle.
+ *
+ * The cache is simulated the same way as in GPU, it is direct mapped by index.
+ *
+ * @param indices triangle list
+ * @param nofIndices number of indices
+ * @param cacheSize number of entries of cache, power of two (see GPU::setVertexCacheSize)
+ *
+ * @return misses / triangles, between 0.5 and 3 for usual meshes
+ */
+float vertexCacheMissRatio(uint32_t const*indices,uint32_t nofIndices,uint32_t cacheSize){
+  if(nofIndices < 3 || cacheSize == 0)return 3.f;
+  std::vector<uint32_t>tags(cacheSize,0xffffffffu);
+  uint32_t misses = 0;
+  for(uint32_t i=0;i<nofIndices;++i){
+    uint32_t&tag = tags[indices[i]&(cacheSize-1)];
+    if(tag != indices[i]){
+      tag = indices[i];
+      misses++;
+    }
+  }
+  return (float)misses/(float)(nofIndices/3);
+}
@@ -0,0 +1,19 @@
+/*!
+ * @file
+ * @brief This file contains preparation of index and vertex buffers for the software GPU
+ *
+ * Typical use before upload:
+ *  - optimizeVertexCache reorders triangles so that shaded vertices are reused by the vertex cache
+ *  - optimizeVertexFetch reorders vertices in order of first use, so fetches go forward through memory
+ *  - selectIndexType and narrowIndices store indices in the narrowest type
+ */
+
+#pragma once
+
+#include <student/fwd.hpp>
+
+IndexType selectIndexType     (uint32_t nofVertices);
+void      narrowIndices       (void*output,uint32_t const*indices,uint32_t nofIndices,IndexType type);
+void      optimizeVertexCache (uint32_t*indices,uint32_t nofIndices,uint32_t nofVertices,uint32_t cacheSize);
+uint32_t  optimizeVertexFetch (void*vertices,uint32_t nofVertices,uint32_t vertexStride,uint32_t*indices,uint32_t nofIndices);
+float     vertexCacheMissRatio(uint32_t const*indices,uint32_t nofIndices,uint32_t cacheSize);
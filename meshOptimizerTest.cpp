@@ -0,0 +1,92 @@
+/*!
+ * @file
+ * @brief This file contains check of triangle and vertex reordering
+ *
+ * Triangles of the bunny are shuffled, so the input has no locality, then they are
+ * reordered by optimizeVertexCache (Tipsify) and optimizeVertexFetch. The check fails
+ * if vertexCacheMissRatio does not fall or if the reordered mesh does not consist of
+ * exactly the same triangles (compared by vertex contents, with the same winding).
+ * It is a standalone executable, build it like the benchmark, e.g.
+ *   add_executable(meshOptimizerTest student/meshOptimizerTest.cpp student/meshOptimizer.cpp student/bunny.cpp)
+ *
+ * Usage: meshOptimizerTest
+ */
+
+#include <student/meshOptimizer.hpp>
+#include <student/bunny.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace{
+
+/// cache of GPU, see GPU::setVertexCacheSize
+uint32_t const cacheSize = 256;
+
+using Key      = std::array<float,6>;
+using Triangle = std::array<Key,3>;
+
+Key key(BunnyVertex const&v){
+  return {v.position.x,v.position.y,v.position.z,v.normal.x,v.normal.y,v.normal.z};
+}
+
+/**
+ * @brief This function returns sorted triangles with their smallest vertex first.
+ *
+ * Rotation keeps winding, so flipped triangles are reported as different.
+ */
+std::vector<Triangle>triangles(std::vector<BunnyVertex>const&vertices,std::vector<uint32_t>const&indices){
+  std::vector<Triangle>result;
+  for(size_t t=0;t+2<indices.size();t+=3){
+    Triangle tri = {key(vertices[indices[t]]),key(vertices[indices[t+1]]),key(vertices[indices[t+2]])};
+    std::rotate(tri.begin(),std::min_element(tri.begin(),tri.end()),tri.end());
+    result.push_back(tri);
+  }
+  std::sort(result.begin(),result.end());
+  return result;
+}
+
+}
+
+int main(){
+  std::vector<BunnyVertex>vertices(bunnyVertices,bunnyVertices+1049);
+  VertexIndex const*bunnyIdx = (VertexIndex const*)bunnyIndices;
+  std::vector<uint32_t>indices(bunnyIdx,bunnyIdx+6276);
+
+  //shuffle whole triangles
+  std::vector<uint32_t>order(indices.size()/3);
+  for(uint32_t t=0;t<order.size();++t)order[t] = t;
+  std::shuffle(order.begin(),order.end(),std::mt19937(1234));
+  std::vector<uint32_t>shuffled;
+  for(uint32_t t:order)shuffled.insert(shuffled.end(),indices.begin()+3*t,indices.begin()+3*t+3);
+
+  std::vector<BunnyVertex>newVertices = vertices;
+  std::vector<uint32_t   >newIndices  = shuffled;
+  optimizeVertexCache(newIndices.data(),(uint32_t)newIndices.size(),(uint32_t)newVertices.size(),cacheSize);
+  uint32_t used = optimizeVertexFetch(newVertices.data(),(uint32_t)newVertices.size(),sizeof(BunnyVertex),newIndices.data(),(uint32_t)newIndices.size());
+  newVertices.resize(used);
+
+  float before = vertexCacheMissRatio(shuffled  .data(),(uint32_t)shuffled  .size(),cacheSize);
+  float after  = vertexCacheMissRatio(newIndices.data(),(uint32_t)newIndices.size(),cacheSize);
+  std::printf("ACMR shuffled %.3f, optimized %.3f, %u of %u vertices used\n",before,after,used,(uint32_t)vertices.size());
+
+  bool ok = true;
+  if(!(after < before)){
+    std::fprintf(stderr,"FAILED: vertex cache miss ratio did not fall\n");
+    ok = false;
+  }
+  for(uint32_t i:newIndices)if(i >= used){
+    std::fprintf(stderr,"FAILED: index %u addresses dropped vertex\n",i);
+    ok = false;
+    break;
+  }
+  if(ok && triangles(newVertices,newIndices) != triangles(vertices,shuffled)){
+    std::fprintf(stderr,"FAILED: triangles changed\n");
+    ok = false;
+  }
+  if(!ok)return 1;
+  std::printf("OK\n");
+  return 0;
+}
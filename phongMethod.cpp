@@ -7,7 +7,16 @@
 
 #include <student/phongMethod.hpp>
 #include <student/bunny.hpp>
+#include <student/meshOptimizer.hpp>
 #include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHONG_SSE 1
+#include <immintrin.h>
+#else
+#define PHONG_SSE 0
+#endif
 
 /** \addtogroup shader_side 06. Implementace vertex/fragment shaderu phongovy metody
  * Vašim úkolem ve vertex a fragment shaderu je transformovat trojúhelníky pomocí view a projekční matice a spočítat phongův osvětlovací model.
@@ -27,6 +36,17 @@
  */
 
 
+/**
+ * @brief This function computes uniforms of phong shaders that are constant in a draw.
+ *
+ * It is attached as uniform preamble, it stores proj * view to uniform 4.
+ *
+ * @param uniforms uniforms of phong program
+ */
+void phong_preamble(Uniforms&uniforms){
+  uniforms.uniform[4].m4 = uniforms.uniform[1].m4*uniforms.uniform[0].m4;
+}
+
 /**
  * @brief This function represents vertex shader of phong method.
  *
@@ -62,8 +82,8 @@ void phong_VS(OutVertex&outVertex,InVertex const&inVertex,Uniforms const&uniform
     outVertex.attributes[1].v3 = inVertex.attributes[1].v3;
 
     //inspiracia z czFlagMethod.cpp
-    auto const& mvp = uniforms.uniform[1].m4*uniforms.uniform[0].m4 ;
-    outVertex.gl_Position = mvp*glm::vec4(inVertex.attributes[0].v3,1.f);
+    // proj * view spocita phong_preamble raz za kreslenie do stvrtej uniformnej premennej
+    outVertex.gl_Position = uniforms.uniform[4].m4*glm::vec4(inVertex.attributes[0].v3,1.f);
     
 }
 
@@ -175,6 +195,143 @@ void phong_FS(OutFragment&outFragment,InFragment const&inFragment,Uniforms const
  
 }
 
+#if PHONG_SSE
+/**
+ * @brief This function computes sine of 4 values.
+ *
+ * Argument is reduced to [-pi/2, pi/2] and sine is approximated by Taylor polynomial
+ * of degree 11, the error is below 1e-7 for arguments that are not huge.
+ *
+ * @param x arguments
+ *
+ * @return sines of arguments
+ */
+static inline __m128 sinus4(__m128 x){
+  __m128i ki = _mm_cvtps_epi32(_mm_mul_ps(x,_mm_set1_ps(0.31830988618f)));
+  __m128  k  = _mm_cvtepi32_ps(ki);
+  // Cody-Waite, pi je rozdelene na tri casti aby sa r = x - k*pi pocitalo presne
+  __m128 r = _mm_sub_ps(x,_mm_mul_ps(k,_mm_set1_ps(3.140625f)));
+  r = _mm_sub_ps(r,_mm_mul_ps(k,_mm_set1_ps(9.67025756836e-4f)));
+  r = _mm_sub_ps(r,_mm_mul_ps(k,_mm_set1_ps(6.27711415291e-7f)));
+  __m128 r2 = _mm_mul_ps(r,r);
+  __m128 p  = _mm_set1_ps(-2.50521083854e-8f);
+  p = _mm_add_ps(_mm_mul_ps(p,r2),_mm_set1_ps( 2.75573192240e-6f));
+  p = _mm_add_ps(_mm_mul_ps(p,r2),_mm_set1_ps(-1.98412698413e-4f));
+  p = _mm_add_ps(_mm_mul_ps(p,r2),_mm_set1_ps( 8.33333333333e-3f));
+  p = _mm_add_ps(_mm_mul_ps(p,r2),_mm_set1_ps(-1.66666666667e-1f));
+  p = _mm_add_ps(r,_mm_mul_ps(_mm_mul_ps(p,r2),r));
+  // sin(x) = (-1)^k sin(r)
+  __m128 znamienko = _mm_castsi128_ps(_mm_slli_epi32(ki,31));
+  return _mm_xor_ps(p,znamienko);
+}
+
+/**
+ * @brief This function computes x^40 of 4 values by repeated squaring.
+ *
+ * @param x values
+ *
+ * @return x^40
+ */
+static inline __m128 mocnina40(__m128 x){
+  __m128 x2  = _mm_mul_ps(x  ,x  );
+  __m128 x4  = _mm_mul_ps(x2 ,x2 );
+  __m128 x8  = _mm_mul_ps(x4 ,x4 );
+  __m128 x16 = _mm_mul_ps(x8 ,x8 );
+  __m128 x32 = _mm_mul_ps(x16,x16);
+  return _mm_mul_ps(x32,x8);
+}
+
+/**
+ * @brief This function normalizes 4 vectors stored by components.
+ */
+static inline void normalize4(__m128&x,__m128&y,__m128&z){
+  __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x),_mm_mul_ps(y,y)),_mm_mul_ps(z,z)));
+  x = _mm_div_ps(x,d);
+  y = _mm_div_ps(y,d);
+  z = _mm_div_ps(z,d);
+}
+
+/**
+ * @brief This function selects a where mask is set and b elsewhere.
+ */
+static inline __m128 vyber4(__m128 maska,__m128 a,__m128 b){
+  return _mm_or_ps(_mm_and_ps(maska,a),_mm_andnot_ps(maska,b));
+}
+#endif
+
+/**
+ * @brief This function represents batched fragment shader of phong method.
+ *
+ * It computes the same model as phong_FS for 4 fragments at once with SSE
+ * (x^40 by squaring, polynomial sine), so 8 fragments of two quads take two steps.
+ * The result differs from phong_FS by less than 1/255.
+ *
+ * @param outFragments output fragments
+ * @param inFragments input fragments
+ * @param nofFragments number of fragments
+ * @param uniforms uniform variables
+ */
+void phong_FS_batch(OutFragment*outFragments,InFragment const*inFragments,uint32_t nofFragments,Uniforms const&uniforms){
+  uint32_t i = 0;
+#if PHONG_SSE
+  glm::vec3 const&kamera = uniforms.uniform[3].v3;
+  glm::vec3 const&svetlo = uniforms.uniform[2].v3;
+  for(;i+4<=nofFragments;i+=4){
+    // prevod 4 fragmentov na zlozky
+    alignas(16) float z[6][4];
+    for(int l=0;l<4;++l){
+      glm::vec3 const&p = inFragments[i+l].attributes[0].v3;
+      glm::vec3 const&n = inFragments[i+l].attributes[1].v3;
+      z[0][l] = p.x; z[1][l] = p.y; z[2][l] = p.z;
+      z[3][l] = n.x; z[4][l] = n.y; z[5][l] = n.z;
+    }
+    __m128 Px = _mm_load_ps(z[0]),Py = _mm_load_ps(z[1]),Pz = _mm_load_ps(z[2]);
+    __m128 Nx = _mm_load_ps(z[3]),Ny = _mm_load_ps(z[4]),Nz = _mm_load_ps(z[5]);
+    __m128 Vx = _mm_sub_ps(_mm_set1_ps(kamera.x),Px),Vy = _mm_sub_ps(_mm_set1_ps(kamera.y),Py),Vz = _mm_sub_ps(_mm_set1_ps(kamera.z),Pz);
+    __m128 Lx = _mm_sub_ps(_mm_set1_ps(svetlo.x),Px),Ly = _mm_sub_ps(_mm_set1_ps(svetlo.y),Py),Lz = _mm_sub_ps(_mm_set1_ps(svetlo.z),Pz);
+    normalize4(Nx,Ny,Nz);
+    normalize4(Vx,Vy,Vz);
+    normalize4(Lx,Ly,Lz);
+
+    __m128 nula  = _mm_setzero_ps();
+    __m128 jedna = _mm_set1_ps(1.f);
+    __m128 t = _mm_and_ps(_mm_cmpgt_ps(Ny,nula),_mm_mul_ps(Ny,Ny));
+
+    // pruhy, zlty pruh ak je neparny pruh v kladnej casti alebo parny v zapornej
+    __m128 desat = _mm_set1_ps(10.f);
+    __m128 c = _mm_mul_ps(_mm_add_ps(Px,_mm_div_ps(sinus4(_mm_mul_ps(Py,desat)),desat)),desat);
+    __m128 neparny = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvttps_epi32(c),_mm_set1_epi32(1)),_mm_set1_epi32(1)));
+    __m128 kladny  = _mm_cmpge_ps(c,nula);
+    __m128 zlty    = _mm_andnot_ps(_mm_xor_ps(neparny,kladny),_mm_castsi128_ps(_mm_set1_epi32(-1)));
+    __m128 farbaR  = _mm_and_ps(zlty,jedna);
+    __m128 farbaG  = vyber4(zlty,jedna,_mm_set1_ps(.5f));
+    __m128 jedna_t = _mm_sub_ps(jedna,t);
+    __m128 diffR = _mm_add_ps(t,_mm_mul_ps(farbaR,jedna_t));
+    __m128 diffG = _mm_add_ps(t,_mm_mul_ps(farbaG,jedna_t));
+    __m128 diffB = t;
+
+    __m128 df  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Nx,Lx),_mm_mul_ps(Ny,Ly)),_mm_mul_ps(Nz,Lz));
+    __m128 df2 = _mm_max_ps(df,nula);
+    __m128 dva_df = _mm_add_ps(df,df);
+    __m128 Rx = _mm_sub_ps(_mm_mul_ps(dva_df,Nx),Lx);
+    __m128 Ry = _mm_sub_ps(_mm_mul_ps(dva_df,Ny),Ly);
+    __m128 Rz = _mm_sub_ps(_mm_mul_ps(dva_df,Nz),Lz);
+    normalize4(Rx,Ry,Rz);
+    __m128 zatvorka = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Vx,Rx),_mm_mul_ps(Vy,Ry)),_mm_mul_ps(Vz,Rz)),nula);
+    __m128 spekular = mocnina40(zatvorka);
+
+    alignas(16) float farba[3][4];
+    _mm_store_ps(farba[0],_mm_min_ps(_mm_add_ps(spekular,_mm_mul_ps(df2,diffR)),jedna));
+    _mm_store_ps(farba[1],_mm_min_ps(_mm_add_ps(spekular,_mm_mul_ps(df2,diffG)),jedna));
+    _mm_store_ps(farba[2],_mm_min_ps(_mm_add_ps(spekular,_mm_mul_ps(df2,diffB)),jedna));
+    for(int l=0;l<4;++l)
+      outFragments[i+l].gl_FragColor = glm::vec4(farba[0][l],farba[1][l],farba[2][l],1.f);
+  }
+#endif
+  for(;i<nofFragments;++i)
+    phong_FS(outFragments[i],inFragments[i],uniforms);
+}
+
 /// @}
 
 /** \addtogroup cpu_side 07. Implementace vykreslení králička s phongovým osvětlovacím modelem.
@@ -209,19 +366,42 @@ PhongMethod::PhongMethod(){
 ///  - gpu.createProgram()
 ///  - gpu.attachShaders()
 ///  - gpu.setVS2FSType()
-    size_t bufSize =  sizeof(struct BunnyVertex)* 1049;
+    // trojuholniky sa preusporiadaju pre cache vrcholov, vrcholy podla prveho pouzitia
+    // a indexy sa ulozia v najuzsom type, kralik ma 1049 vrcholov, takze staci uint16_t
+    std::vector<BunnyVertex> vrcholy(bunnyVertices, bunnyVertices + 1049);
+    VertexIndex const* bunny_indexy = (VertexIndex const*)bunnyIndices;
+    std::vector<uint32_t> indexy(bunny_indexy, bunny_indexy + 6276);
+    // velkost simulovanej cache je velkost cache GPU, novy poriadok sa pouzije len ak je lepsi
+    std::vector<BunnyVertex> nove_vrcholy = vrcholy;
+    std::vector<uint32_t> nove_indexy = indexy;
+    optimizeVertexCache(nove_indexy.data(), (uint32_t)nove_indexy.size(), (uint32_t)nove_vrcholy.size(), 256);
+    uint32_t pocet_vrcholov = optimizeVertexFetch(nove_vrcholy.data(), (uint32_t)nove_vrcholy.size(), sizeof(BunnyVertex), nove_indexy.data(), (uint32_t)nove_indexy.size());
+    if (vertexCacheMissRatio(nove_indexy.data(), (uint32_t)nove_indexy.size(), 256) < vertexCacheMissRatio(indexy.data(), (uint32_t)indexy.size(), 256))
+    {
+        vrcholy.swap(nove_vrcholy);
+        indexy.swap(nove_indexy);
+    }
+    else
+    {
+        pocet_vrcholov = (uint32_t)vrcholy.size();
+    }
+    IndexType typ = selectIndexType(pocet_vrcholov);
+
+    size_t bufSize =  sizeof(struct BunnyVertex)* pocet_vrcholov;
     buf = gpu.createBuffer(bufSize);
 
-    gpu.setBufferData(buf, 0, bufSize, bunnyVertices);
-    size_t bufSize2 = sizeof(VertexIndex) * 6277;
+    gpu.setBufferData(buf, 0, bufSize, vrcholy.data());
+    size_t bufSize2 = (size_t)typ * indexy.size();
    
     buf2 = gpu.createBuffer(bufSize2);
 
-    gpu.setBufferData(buf2, 0, bufSize2, bunnyIndices);
+    std::vector<uint8_t> uzke(bufSize2);
+    narrowIndices(uzke.data(), indexy.data(), (uint32_t)indexy.size(), typ);
+    gpu.setBufferData(buf2, 0, bufSize2, uzke.data());
     
     
     vao = gpu.createVertexPuller();
-    gpu.setVertexPullerIndexing(vao, IndexType::UINT32, buf2);
+    gpu.setVertexPullerIndexing(vao, typ, buf2);
     gpu.setVertexPullerHead(vao, 0, AttributeType::VEC3, 6 * sizeof(float), 0, buf);
     gpu.setVertexPullerHead(vao, 1, AttributeType::VEC3, 6 * sizeof(float), 3 * sizeof(float), buf);
     gpu.enableVertexPullerHead(vao, 0);
@@ -231,6 +411,21 @@ PhongMethod::PhongMethod(){
     gpu.attachShaders(prg, phong_VS, phong_FS);
     gpu.setVS2FSType(prg, 0, AttributeType::VEC3);
     gpu.setVS2FSType(prg, 1, AttributeType::VEC3);
+    gpu.attachFragmentShaderBatch(prg, phong_FS_batch);
+    gpu.attachUniformPreamble(prg, phong_preamble);
+
+    // clear v onDraw len oznaci dlazdice, kralik pokryva malu cast obrazu
+    gpu.setFastClear(true);
+
+    // view, proj, light a camera su v uniform bloku, ktory sa meni raz za snimok
+    ubo = gpu.createUniformBlock();
+    gpu.bindUniformBlock(prg, ubo, 0, 4);
+
+    prikazy.clear(.5f,.5f,.5f,1.f);
+    prikazy.bindVertexPuller(vao);
+    prikazy.useProgram(prg);
+    prikazy.drawTriangles(6276);
+    prikazy.unbindVertexPuller();
 }
 
 
@@ -258,18 +453,12 @@ void PhongMethod::onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 con
 ///  - gpu.unbindVertexPuller()
     
 
-  gpu.clear(.5f,.5f,.5f,1.f);
-  
-  
-  
-  gpu.bindVertexPuller(vao);
-  gpu.useProgram(prg);
-  gpu.programUniformMatrix4f(prg, 0,view );
-  gpu.programUniformMatrix4f(prg, 1, proj);
-  gpu.programUniform3f(prg, 2, light);
-  gpu.programUniform3f(prg, 3, camera);
-  gpu.drawTriangles(6276);
-  gpu.unbindVertexPuller();
+  // prikazy su nahrane v konstruktore, menia sa len data uniform bloku
+  gpu.uniformBlockMatrix4f(ubo, 0, view);
+  gpu.uniformBlockMatrix4f(ubo, 1, proj);
+  gpu.uniformBlock3f(ubo, 2, light);
+  gpu.uniformBlock3f(ubo, 3, camera);
+  gpu.submit(prikazy);
 
 
 }
@@ -283,6 +472,7 @@ PhongMethod::~PhongMethod(){
   ///  - gpu.deleteProgram()
   ///  - gpu.deleteVertexPuller()
   ///  - gpu.deleteBuffer()
+    gpu.deleteUniformBlock(ubo);
     gpu.deleteProgram(prg);
     gpu.deleteVertexPuller(vao);
     gpu.deleteBuffer(buf); gpu.deleteBuffer(buf2);
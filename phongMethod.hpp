@@ -27,6 +27,8 @@ class PhongMethod: public Method{
     BufferID buf2;
     VertexPullerID vao;
     ProgramID prg;
+    CommandBuffer prikazy;
+    UniformBlockID ubo;
 };
 
 /// @}